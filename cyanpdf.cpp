@@ -4,17 +4,18 @@
 */
 
 #include "cyanpdf.h"
+#include "cyanpdfcore.h"
+#include "cyanpdfjob.h"
+#include "cyanpdfqueue.h"
+#include "cyanpdfresources.h"
+#include "cyanpdfprofiles.h"
+#include "cyanpdfdigest.h"
+#include "cyanpdfproof.h"
+#include "cyanpdftrace.h"
 
 #include <QDebug>
 #include <QDir>
 #include <QFile>
-#include <QMimeDatabase>
-#include <QMimeType>
-#include <QCryptographicHash>
-#include <QStandardPaths>
-#include <QProcess>
-#include <QRegularExpression>
-#include <QDirIterator>
 #include <QTimer>
 #include <QImage>
 #include <QHBoxLayout>
@@ -24,288 +25,78 @@
 #include <QSettings>
 #include <QMessageBox>
 #include <QDesktopServices>
+#include <QScrollBar>
+#include <QSignalBlocker>
+#include <QPainter>
+#include <QMimeData>
+#include <QAction>
+#include <QThread>
+#include <QtConcurrent>
+#include <QLoggingCategory>
 
-#include <lcms2.h>
+#define CYANPDF_PREVIEW_CACHE 192
+#define CYANPDF_PREVIEW_PREFETCH 2
+#define CYANPDF_THUMB_SIZE 64
+
+Q_LOGGING_CATEGORY(lcStartup, "cyanpdf.startup", QtWarningMsg)
 
 CyanPDF::CyanPDF(QWidget *parent)
     : QMainWindow(parent)
     , mDocument(nullptr)
     , mRenderer(nullptr)
+    , mThumbRenderer(nullptr)
     , mLabel(nullptr)
+    , mButtonPrev(nullptr)
+    , mButtonNext(nullptr)
+    , mPageSpin(nullptr)
+    , mCheckProof(nullptr)
+    , mCheckGamut(nullptr)
+    , mCheckInk(nullptr)
+    , mInkSpin(nullptr)
+    , mThumbs(nullptr)
+    , mPage(-1)
     , mComboDefRgb(nullptr)
     , mComboDefCmyk(nullptr)
     , mComboDefGray(nullptr)
     , mComboOutIcc(nullptr)
     , mComboRenderIntent(nullptr)
+    , mComboPreset(nullptr)
     , mCheckBlackPoint(nullptr)
     , mCheckOverrideIcc(nullptr)
     , mSpecsList(nullptr)
+    , mProgress(nullptr)
+    , mButtonSave(nullptr)
+    , mButtonCancel(nullptr)
+    , mJob(nullptr)
+    , mQueue(nullptr)
+    , mQueueList(nullptr)
+    , mQueueSerial(0)
+    , mProfilePool(nullptr)
+    , mPreflightWatcher(nullptr)
+    , mVerifyWatcher(nullptr)
+    , mInkWatcher(nullptr)
+    , mHeatmapWatcher(nullptr)
+    , mHeatmapPage(-1)
+    , mProfilesReady(false)
+    , mSettingsReady(false)
 {
+    mStartupTimer.start();
     setupWidgets();
+    QTimer::singleShot(0, this, [this]() {
+        qCInfo(lcStartup) << "window shown in" << mStartupTimer.elapsed() << "ms";
+    });
 }
 
 CyanPDF::~CyanPDF()
 {
+    mProfilePool->clear();
+    mProfilePool->waitForDone();
+    if (mJob) { mJob->cancel(); }
+    for (const QString &id : mQueueItems.keys()) { mQueue->cancel(id); }
     mDocument->close();
     writeSettings();
 }
 
-const QString CyanPDF::getGhostscript(bool pathOnly)
-{
-#ifdef Q_OS_WIN
-    QString appDir = QString("%1/gs").arg(qApp->applicationDirPath());
-    if (QFile::exists(appDir)) {
-        QString bin64 = appDir + "/bin/gswin64c.exe";
-        if (QFile::exists(bin64)) { return pathOnly ? appDir : bin64; }
-        QString bin32 = appDir + "/bin/gswin32c.exe";
-        if (QFile::exists(bin32)) { return pathOnly ? appDir : bin32; }
-    }
-    QString programFilesPath(qgetenv("PROGRAMFILES"));
-    QDirIterator it(programFilesPath + "/gs", {"*.*"}, QDir::Dirs);
-    while (it.hasNext()) {
-        QString folder = it.next();
-        QString bin64 = folder + "/bin/gswin64c.exe";
-        if (QFile::exists(bin64)) { return pathOnly ? folder : bin64; }
-        QString bin32 = folder + "/bin/gswin32c.exe";
-        if (QFile::exists(bin32)) { return pathOnly ? folder : bin32; }
-    }
-#endif
-    QString gs = QStandardPaths::findExecutable("gs");
-    if (gs.isEmpty()) {
-        gs = QStandardPaths::findExecutable("gs", {"/opt/local/bin",
-                                                   "/usr/local/bin"});
-    }
-    if (gs.isEmpty()) { return QString(); }
-
-    QFileInfo info(gs);
-    return pathOnly ? info.absoluteDir().absolutePath() : info.absoluteFilePath();
-}
-
-const QString CyanPDF::getGhostscriptVersion()
-{
-    const QString gs = getGhostscript();
-    if (!QFile::exists(gs)) { return QString(); }
-    QProcess proc;
-    proc.start(gs, {"--version"});
-    if (proc.waitForStarted()) {
-        proc.waitForFinished();
-        QByteArray result = proc.readAll();
-        if (proc.exitCode() == 0) { return result.trimmed(); }
-    }
-    return QString();
-}
-
-const QString CyanPDF::getPostscript(const QString &filename,
-                                     const QString &profile)
-{
-    if (!isPDF(filename) || !isICC(profile)) { return QString(); }
-
-    const QString gsPath = getGhostscript(true);
-    if (!QFile::exists(gsPath)) { return QString(); }
-
-    const QString gsVer = getGhostscriptVersion();
-    if (gsVer.isEmpty()) { return QString(); }
-
-    const QString ps = QString("%1/../share/ghostscript/%2/lib/PDFX_def.ps").arg(gsPath, gsVer);
-
-    QFile file(ps);
-    QString content;
-    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        content = file.readAll();
-        file.close();
-    }
-
-    if (!content.isEmpty()) {
-        static QRegularExpression regex("/ICCProfile \\([^)]*\\) def");
-        const QString output = QString("%1/%2.ps").arg(getCachePath(), getChecksum(filename));
-        const QString replacement = QString("/ICCProfile (%1) def").arg(profile);
-        const QString modified = content.replace(regex, replacement);
-        QFile newFile(output);
-        if (newFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-            newFile.write(modified.toUtf8());
-            newFile.close();
-            return output;
-        }
-    }
-
-    return QString();
-}
-
-const QString CyanPDF::getCachePath()
-{
-    QStringList paths = QStandardPaths::standardLocations(QStandardPaths::GenericCacheLocation);
-    QString path = paths.first();
-    if (path.isEmpty()) { path = QDir::tempPath(); }
-    path.append("/cyanpdf");
-    if (!QFile::exists(path)) {
-        QDir dir(path);
-        if (!dir.mkpath(path)) { return QString(); }
-    }
-    return path;
-}
-
-const QString CyanPDF::getChecksum(const QString &filename)
-{
-    if (!isPDF(filename)) { return QString(); }
-    QFile file(filename);
-    QString result;
-    if (file.open(QFile::ReadOnly)) {
-        QCryptographicHash hash(QCryptographicHash::Sha256);
-        if (hash.addData(&file)) { result = hash.result().toHex(); }
-        file.close();
-    }
-    return result;
-}
-
-const QStringList CyanPDF::getConvertArgs(const QString &inputFile,
-                                          const QString &outputFile,
-                                          const QString &outputIcc,
-                                          const QString defRgbIcc,
-                                          const QString defGrayIcc,
-                                          const QString defCmykIcc,
-                                          const int &colorSpace,
-                                          const int &renderIntent,
-                                          const bool &blackPoint,
-                                          const bool &overrideIcc)
-{
-    QStringList args;
-    const QString cs = colorSpace == ColorSpace::CMYK ? "CMYK" : "GRAY";
-    const QString ps = getPostscript(inputFile, outputIcc);
-
-    if (!QFile::exists(ps) ||
-        !isICC(defRgbIcc) ||
-        !isICC(defGrayIcc) ||
-        !isICC(defCmykIcc) ||
-        !isICC(outputIcc) ||
-        !isPDF(inputFile)) { return args; }
-
-    if (getColorspace(defRgbIcc) != ColorSpace::RGB ||
-        getColorspace(defGrayIcc) != ColorSpace::GRAY ||
-        getColorspace(defCmykIcc) != ColorSpace::CMYK ||
-        getColorspace(outputIcc) != colorSpace) { return args; }
-
-    args << "-dPDFX" << "-dBATCH" << "-dNOPAUSE" << "-dNOSAFER" << "-sDEVICE=pdfwrite"
-         << "-dEncodeColorImages=true" << "-dEmbedAllFonts=true"
-         << QString("-dOverrideICC=%1").arg(overrideIcc ? "true" : "false")
-         << QString("-sProcessColorModel=Device%1").arg(cs)
-         << QString("-sColorConversionStrategy=%1").arg(cs)
-         << QString("-sColorConversionStrategyForImages=%1").arg(cs)
-         << QString("-dRenderIntent=%1").arg(QString::number(renderIntent))
-         << QString("-dPreserveBlack=%1").arg(blackPoint ? "true" : "false")
-         << QString("-sDefaultRGBProfile=%1").arg(defRgbIcc)
-         << QString("-sDefaultGrayProfile=%1").arg(defGrayIcc)
-         << QString("-sDefaultCMYKProfile=%1").arg(defCmykIcc)
-         << QString("-sOutputICCProfile=%1").arg(outputIcc)
-         << QString("-sOutputFile=%1").arg(outputFile)
-         << QString("%1").arg(ps)
-         << QString("%1").arg(inputFile);
-    return args;
-}
-
-const int CyanPDF::getColorspace(const QString &profile)
-{
-    int result = ColorSpace::NA;
-    if (!isICC(profile)) { return result; }
-    auto hprofile = cmsOpenProfileFromFile(profile.toStdString().c_str(), "r");
-    if (hprofile) {
-        auto space = cmsGetColorSpace(hprofile);
-        switch (space) {
-        case cmsSigRgbData:
-            result = ColorSpace::RGB;
-            break;
-        case cmsSigCmykData:
-            result = ColorSpace::CMYK;
-            break;
-        case cmsSigGrayData:
-            result = ColorSpace::GRAY;
-            break;
-        default:;
-        }
-    }
-    cmsCloseProfile(hprofile);
-    return result;
-}
-
-const QStringList CyanPDF::getProfiles(const int &colorspace)
-{
-    QStringList folders;
-#ifdef Q_OS_WIN
-    folders << QDir::rootPath() + "/WINDOWS/System32/spool/drivers/color";
-#elif defined(Q_OS_MAC)
-    folders << "/Library/ColorSync/Profiles";
-    folders << QDir::homePath() + "/Library/ColorSync/Profiles";
-#else
-    const QStringList common = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation);
-    for (const QString &path : common) { folders << QString("%1/color/icc").arg(path); }
-#endif
-    folders << QDir::homePath() + "/.color/icc";
-
-    QStringList profiles;
-    for (const QString &path : folders) {
-        QDir directory(path);
-        if (directory.exists()) {
-            QDir::Filters filters = QDir::Files | QDir::Readable;
-            QDirIterator it(directory.absolutePath(),
-                            {"*.icc"},
-                            filters,
-                            QDirIterator::Subdirectories);
-            while (it.hasNext()) {
-                const QString profile = it.next();
-                if (getColorspace(profile) == colorspace) { profiles << profile; }
-            }
-        }
-    }
-    return profiles;
-}
-
-const QString CyanPDF::getProfileName(const QString &profile)
-{
-    QString result;
-    if (!isICC(profile)) { return result; }
-    auto hprofile = cmsOpenProfileFromFile(profile.toStdString().c_str(), "r");
-    if (hprofile) {
-        cmsUInt32Number size = 0;
-        size = cmsGetProfileInfoASCII(hprofile,
-                                      cmsInfoDescription,
-                                      "en",
-                                      "US",
-                                      nullptr,
-                                      0);
-        if (size > 0) {
-            std::vector<char> buffer(size);
-            cmsUInt32Number newsize = cmsGetProfileInfoASCII(hprofile,
-                                                             cmsInfoDescription,
-                                                             "en",
-                                                             "US",
-                                                             &buffer[0],
-                                                             size);
-            if (size == newsize) { result = buffer.data(); }
-        }
-    }
-    cmsCloseProfile(hprofile);
-    return result.isEmpty() ? profile : result;
-}
-
-const bool CyanPDF::isFileType(const QString &filename,
-                               const QString &mime,
-                               const bool &startsWith)
-{
-    if (!QFile::exists(filename)) { return false; }
-    QMimeDatabase db;
-    QMimeType type = db.mimeTypeForFile(filename);
-    return (startsWith? type.name().startsWith(mime) : type.name() == mime);
-}
-
-const bool CyanPDF::isPDF(const QString &filename)
-{
-    return isFileType(filename, "application/pdf");
-}
-
-const bool CyanPDF::isICC(const QString &filename)
-{
-    return isFileType(filename, "application/vnd.iccprofile");
-}
-
 void CyanPDF::setupWidgets()
 {
     setWindowTitle("Cyan PDF");
@@ -314,18 +105,138 @@ void CyanPDF::setupWidgets()
 
     mDocument = new QPdfDocument(this);
     mRenderer = new QPdfPageRenderer(this);
+    mRenderer->setRenderMode(QPdfPageRenderer::RenderMode::MultiThreaded);
+    mThumbRenderer = new QPdfPageRenderer(this);
+    mThumbRenderer->setRenderMode(QPdfPageRenderer::RenderMode::MultiThreaded);
+    mProfilePool = new QThreadPool(this);
+
+    // cost is in KiB
+    mPageCache.setMaxCost(CYANPDF_PREVIEW_CACHE * 1024);
 
     mLabel = new QLabel(this);
     mLabel->setScaledContents(false);
+    mLabel->setAlignment(Qt::AlignCenter);
     mLabel->setFixedWidth(400);
+    mLabel->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
     mLabel->setBackgroundRole(QPalette::Dark);
     mLabel->setAutoFillBackground(true);
 
+    mButtonPrev = new QPushButton(this);
+    mButtonPrev->setShortcut(QKeySequence("PgUp"));
+    mButtonPrev->setToolTip(tr("Previous page"));
+    QIcon iconPrev = QIcon::fromTheme("go-previous");
+    if (iconPrev.isNull()) { iconPrev = QIcon::fromTheme("go-previous-symbolic"); }
+    mButtonPrev->setIcon(iconPrev);
+    mButtonPrev->setEnabled(false);
+    connect(mButtonPrev, &QPushButton::released,
+            this, [this]{ showPage(mPage - 1); });
+
+    mButtonNext = new QPushButton(this);
+    mButtonNext->setShortcut(QKeySequence("PgDown"));
+    mButtonNext->setToolTip(tr("Next page"));
+    QIcon iconNext = QIcon::fromTheme("go-next");
+    if (iconNext.isNull()) { iconNext = QIcon::fromTheme("go-next-symbolic"); }
+    mButtonNext->setIcon(iconNext);
+    mButtonNext->setEnabled(false);
+    connect(mButtonNext, &QPushButton::released,
+            this, [this]{ showPage(mPage + 1); });
+
+    mPageSpin = new QSpinBox(this);
+    mPageSpin->setRange(0, 0);
+    mPageSpin->setEnabled(false);
+    connect(mPageSpin, &QSpinBox::valueChanged,
+            this, [this](int value) { showPage(value - 1); });
+
+    mCheckProof = new QCheckBox(tr("Proof"), this);
+    mCheckProof->setToolTip(tr("Simulate the output profile on screen"));
+    connect(mCheckProof, &QCheckBox::toggled,
+            this, [this](bool checked) {
+        mCheckGamut->setEnabled(checked);
+        updatePreview();
+    });
+
+    mCheckGamut = new QCheckBox(tr("Gamut"), this);
+    mCheckGamut->setToolTip(tr("Highlight colors outside the output profile gamut"));
+    mCheckGamut->setEnabled(false);
+    connect(mCheckGamut, &QCheckBox::toggled,
+            this, &CyanPDF::updatePreview);
+
+    mCheckInk = new QCheckBox(tr("Ink"), this);
+    mCheckInk->setToolTip(tr("Highlight areas of the saved document above the total ink limit"));
+    mCheckInk->setEnabled(false);
+    connect(mCheckInk, &QCheckBox::toggled,
+            this, &CyanPDF::updatePreview);
+
+    mInkSpin = new QSpinBox(this);
+    mInkSpin->setToolTip(tr("Total ink limit"));
+    mInkSpin->setRange(100, 400);
+    mInkSpin->setSingleStep(10);
+    mInkSpin->setSuffix("%");
+    mInkSpin->setValue(CYANPDF_INK_LIMIT);
+
+    mThumbs = new QListWidget(this);
+    mThumbs->setViewMode(QListView::IconMode);
+    mThumbs->setFlow(QListView::LeftToRight);
+    mThumbs->setWrapping(false);
+    mThumbs->setMovement(QListView::Static);
+    mThumbs->setUniformItemSizes(true);
+    mThumbs->setIconSize(QSize(CYANPDF_THUMB_SIZE, CYANPDF_THUMB_SIZE));
+    mThumbs->setFixedWidth(400);
+    mThumbs->setFixedHeight(CYANPDF_THUMB_SIZE + 48);
+    mThumbs->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+    connect(mThumbs, &QListWidget::currentRowChanged,
+            this, &CyanPDF::showPage);
+    connect(mThumbs->horizontalScrollBar(), &QScrollBar::valueChanged,
+            this, &CyanPDF::requestThumbnails);
+
+    connect(mRenderer, &QPdfPageRenderer::pageRendered,
+            this, [this](int pageNumber,
+                         QSize imageSize,
+                         const QImage &image,
+                         QPdfDocumentRenderOptions options,
+                         quint64 requestId) {
+        Q_UNUSED(imageSize)
+        Q_UNUSED(options)
+        if (mRequestTimes.contains(requestId)) {
+            CyanPDFTrace::complete("renderPage", mRequestTimes.take(requestId), QString::number(pageNumber + 1));
+        }
+        if (!mPageRequests.contains(requestId)) { return; }
+        mPageRequests.remove(requestId);
+        if (image.isNull()) { return; }
+        QImage page = image;
+        page.setDevicePixelRatio(mLabel->devicePixelRatioF());
+        mPageCache.insert(pageNumber, new QImage(page), qMax<qsizetype>(1, page.sizeInBytes() / 1024));
+        if (pageNumber == mPage) { displayPage(page); }
+    });
+
+    connect(mThumbRenderer, &QPdfPageRenderer::pageRendered,
+            this, [this](int pageNumber,
+                         QSize imageSize,
+                         const QImage &image,
+                         QPdfDocumentRenderOptions options,
+                         quint64 requestId) {
+        Q_UNUSED(imageSize)
+        Q_UNUSED(options)
+        if (mRequestTimes.contains(requestId)) {
+            CyanPDFTrace::complete("renderThumbnail", mRequestTimes.take(requestId), QString::number(pageNumber + 1));
+        }
+        if (!mThumbRequests.contains(requestId)) { return; }
+        mThumbRequests.remove(requestId);
+        const auto item = mThumbs->item(pageNumber);
+        if (image.isNull() || !item) { return; }
+        QImage thumb = image;
+        thumb.setDevicePixelRatio(mThumbs->devicePixelRatioF());
+        item->setIcon(QIcon(QPixmap::fromImage(thumb)));
+        mThumbsDone.insert(pageNumber);
+    });
+
     mComboDefRgb = new ComboBox(this);
     mComboDefCmyk = new ComboBox(this);
     mComboDefGray = new ComboBox(this);
     mComboOutIcc = new ComboBox(this);
     mComboRenderIntent = new ComboBox(this);
+    mComboPreset = new ComboBox(this);
+    mComboPreset->setToolTip(tr("Image resolution, compression and font settings of the output"));
 
     mCheckBlackPoint = new QCheckBox(this);
     mCheckBlackPoint->setText(tr("Black Point Compensation"));
@@ -340,17 +251,96 @@ void CyanPDF::setupWidgets()
     mSpecsList->setDropIndicatorShown(false);
     mSpecsList->setIndentation(0);
 
+    mQueueList = new QTreeWidget(this);
+    mQueueList->setHeaderLabels({tr("Document"), tr("Pages"), tr("Status")});
+    mQueueList->setRootIsDecorated(false);
+    mQueueList->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    mQueueList->setToolTip(tr("Documents dropped on the window, converted with the settings they were queued with"));
+    mQueueList->setVisible(false);
+    connect(mQueueList, &QTreeWidget::itemDoubleClicked,
+            this, [](QTreeWidgetItem *item) {
+        const QString output = item->data(0, Qt::UserRole + 1).toString();
+        if (!output.isEmpty()) { QDesktopServices::openUrl(QUrl::fromLocalFile(output)); }
+    });
+
+    const auto removeAction = new QAction(tr("Remove"), mQueueList);
+    removeAction->setShortcut(QKeySequence::Delete);
+    removeAction->setShortcutContext(Qt::WidgetShortcut);
+    mQueueList->addAction(removeAction);
+    connect(removeAction, &QAction::triggered,
+            this, [this]() {
+        // unfinished documents are canceled first and removed on the next press
+        for (const auto item : mQueueList->selectedItems()) {
+            const QString id = item->data(0, Qt::UserRole).toString();
+            if (!item->data(0, Qt::UserRole + 2).toBool() && mQueue->cancel(id)) { continue; }
+            mQueueItems.remove(id);
+            delete item;
+        }
+        mQueueList->setVisible(mQueueList->topLevelItemCount() > 0);
+    });
+
+    // leave room for the preview, and let small documents pass large ones
+    mQueue = new CyanPDFQueue(this);
+    mQueue->setOrder(CyanPDFQueue::Order::ShortestFirst);
+    mQueue->setMaxJobs(qMax(1, QThread::idealThreadCount() / 2));
+    CyanPDFResources::setMaxRuns(mQueue->maxJobs());
+    connect(mQueue, &CyanPDFQueue::jobStarted,
+            this, [this](CyanPDFJob *job) {
+        const auto item = mQueueItems.value(job->settings().id);
+        if (!item) { return; }
+        item->setText(2, tr("Converting"));
+        connect(job, &CyanPDFJob::progress,
+                this, [item](int page, int pages) {
+            if (pages > 0) { item->setText(2, tr("Page %1 of %2").arg(page).arg(pages)); }
+        });
+    });
+    connect(mQueue, &CyanPDFQueue::jobFinished,
+            this, [this](CyanPDFJob *job, bool success, const QString &error) {
+        const auto item = mQueueItems.value(job->settings().id);
+        if (!item) { return; }
+        item->setData(0, Qt::UserRole + 2, true);
+        if (success) {
+            item->setText(2, tr("Done (%1 s)").arg(QString::number(job->elapsed() / 1000.0, 'f', 2)));
+            item->setToolTip(2, job->settings().outputFile);
+            item->setData(0, Qt::UserRole + 1, job->settings().outputFile);
+        } else if (job->isCanceled()) {
+            item->setText(2, tr("Canceled"));
+        } else {
+            item->setText(2, tr("Failed"));
+            item->setToolTip(2, QString("%1\n\n%2").arg(error, job->log().trimmed()));
+        }
+    });
+    connect(mQueue, &CyanPDFQueue::pendingCanceled,
+            this, [this](const CyanPDFJob::Settings &settings) {
+        const auto item = mQueueItems.value(settings.id);
+        if (!item) { return; }
+        item->setData(0, Qt::UserRole + 2, true);
+        item->setText(2, tr("Canceled"));
+    });
+
+    const auto proofChanged = [this]() {
+        if (mCheckProof->isChecked()) { updatePreview(); }
+    };
+    connect(mComboOutIcc, &QComboBox::currentIndexChanged,
+            this, proofChanged);
+    connect(mComboRenderIntent, &QComboBox::currentIndexChanged,
+            this, proofChanged);
+    connect(mCheckBlackPoint, &QCheckBox::toggled,
+            this, proofChanged);
+
     mComboDefRgb->setObjectName("rgb");
     mComboDefCmyk->setObjectName("cmyk");
     mComboDefGray->setObjectName("gray");
     mComboOutIcc->setObjectName("output");
     mComboRenderIntent->setObjectName("intent");
+    mComboPreset->setObjectName("preset");
 
     mComboDefRgb->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
     mComboDefCmyk->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
     mComboDefGray->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
     mComboOutIcc->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
     mComboRenderIntent->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+    mComboPreset->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
     mCheckBlackPoint->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Preferred);
     mCheckOverrideIcc->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Preferred);
 
@@ -362,12 +352,18 @@ void CyanPDF::setupWidgets()
     const auto grayLay = new QHBoxLayout(grayWid);
     const auto intentWid = new QWidget(this);
     const auto intentLay = new QHBoxLayout(intentWid);
+    const auto presetWid = new QWidget(this);
+    const auto presetLay = new QHBoxLayout(presetWid);
     const auto outputWid = new QWidget(this);
     const auto outputLay = new QHBoxLayout(outputWid);
     const auto extraWid = new QWidget(this);
     const auto extraLay = new QVBoxLayout(extraWid);
     const auto buttonWid = new QWidget(this);
     const auto buttonLay = new QHBoxLayout(buttonWid);
+    const auto navWid = new QWidget(this);
+    const auto navLay = new QHBoxLayout(navWid);
+    const auto previewWid = new QWidget(this);
+    const auto previewLay = new QVBoxLayout(previewWid);
     const auto sideWid = new QWidget(this);
     const auto sideLay = new QVBoxLayout(sideWid);
 
@@ -380,12 +376,18 @@ void CyanPDF::setupWidgets()
     grayLay->setContentsMargins(margins);
     intentWid->setContentsMargins(margins);
     intentLay->setContentsMargins(margins);
+    presetWid->setContentsMargins(margins);
+    presetLay->setContentsMargins(margins);
     outputWid->setContentsMargins(margins);
     outputLay->setContentsMargins(margins);
     extraWid->setContentsMargins(margins);
     extraLay->setContentsMargins(margins);
     buttonWid->setContentsMargins(margins);
     buttonLay->setContentsMargins(margins);
+    navWid->setContentsMargins(margins);
+    navLay->setContentsMargins(margins);
+    previewWid->setContentsMargins(margins);
+    previewLay->setContentsMargins(margins);
 
     auto sideMargins = sideWid->contentsMargins();
     sideMargins.setBottom(0);
@@ -404,6 +406,9 @@ void CyanPDF::setupWidgets()
     intentLay->addWidget(new QLabel(tr("Rendering Intent"), this), Qt::AlignLeft);
     intentLay->addWidget(mComboRenderIntent, Qt::AlignRight);
 
+    presetLay->addWidget(new QLabel(tr("Output Preset"), this), Qt::AlignLeft);
+    presetLay->addWidget(mComboPreset, Qt::AlignRight);
+
     outputLay->addWidget(new QLabel(tr("Output Profile"), this), Qt::AlignLeft);
     outputLay->addWidget(mComboOutIcc, Qt::AlignRight);
 
@@ -431,13 +436,13 @@ void CyanPDF::setupWidgets()
         loadPDF(filename);
     });
 
-    const auto buttonSave = new QPushButton(this);
-    buttonSave->setText(tr("Save"));
-    buttonSave->setShortcut(QKeySequence("Ctrl+S"));
+    mButtonSave = new QPushButton(this);
+    mButtonSave->setText(tr("Save"));
+    mButtonSave->setShortcut(QKeySequence("Ctrl+S"));
     QIcon iconSave = QIcon::fromTheme("document-save");
     if (iconSave.isNull()) { iconSave = QIcon::fromTheme("document-save-symbolic"); }
-    buttonSave->setIcon(iconSave);
-    connect(buttonSave, &QPushButton::released,
+    mButtonSave->setIcon(iconSave);
+    connect(mButtonSave, &QPushButton::released,
             this, [this]{
         const QString filename = QFileDialog::getSaveFileName(this,
                                                               tr("Save PDF"),
@@ -446,6 +451,21 @@ void CyanPDF::setupWidgets()
         savePDF(filename);
     });
 
+    mButtonCancel = new QPushButton(this);
+    mButtonCancel->setText(tr("Cancel"));
+    mButtonCancel->setShortcut(QKeySequence("Esc"));
+    QIcon iconCancel = QIcon::fromTheme("process-stop");
+    if (iconCancel.isNull()) { iconCancel = QIcon::fromTheme("process-stop-symbolic"); }
+    mButtonCancel->setIcon(iconCancel);
+    mButtonCancel->setVisible(false);
+    connect(mButtonCancel, &QPushButton::released,
+            this, &CyanPDF::cancelPDF);
+
+    mProgress = new QProgressBar(this);
+    mProgress->setVisible(false);
+    mProgress->setTextVisible(true);
+    mProgress->setFormat(tr("Page %v of %m"));
+
     const auto buttonClose = new QPushButton(this);
     buttonClose->setText(tr("Quit"));
     buttonClose->setShortcut(QKeySequence("Ctrl+Q"));
@@ -456,10 +476,25 @@ void CyanPDF::setupWidgets()
             this, &QMainWindow::close);
 
     buttonLay->addWidget(buttonOpen);
-    buttonLay->addWidget(buttonSave);
+    buttonLay->addWidget(mButtonSave);
+    buttonLay->addWidget(mButtonCancel);
     buttonLay->addStretch();
     buttonLay->addWidget(buttonClose);
 
+    navLay->addWidget(mButtonPrev);
+    navLay->addWidget(mCheckProof);
+    navLay->addWidget(mCheckGamut);
+    navLay->addWidget(mCheckInk);
+    navLay->addWidget(mInkSpin);
+    navLay->addStretch();
+    navLay->addWidget(mPageSpin);
+    navLay->addStretch();
+    navLay->addWidget(mButtonNext);
+
+    previewLay->addWidget(mLabel);
+    previewLay->addWidget(navWid);
+    previewLay->addWidget(mThumbs);
+
     sideLay->addWidget(appLabel);
     sideLay->addSpacing(10);
     sideLay->addWidget(rgbWid);
@@ -468,133 +503,208 @@ void CyanPDF::setupWidgets()
     sideLay->addSpacing(10);
     sideLay->addWidget(outputWid);
     sideLay->addWidget(intentWid);
+    sideLay->addWidget(presetWid);
     sideLay->addSpacing(5);
     sideLay->addWidget(extraWid);
     sideLay->addWidget(mSpecsList);
+    sideLay->addWidget(mQueueList);
+    sideLay->addWidget(mProgress);
     sideLay->addWidget(buttonWid);
 
     const auto wid = new QWidget(this);
     const auto lay = new QHBoxLayout(wid);
 
     setCentralWidget(wid);
-    lay->addWidget(mLabel);
+    lay->addWidget(previewWid);
     lay->addWidget(sideWid);
 
     populateComboBoxes();
+    setAcceptDrops(true);
 
     QTimer::singleShot(10, this, &CyanPDF::readSettings);
 }
 
 void CyanPDF::populateComboBoxes()
 {
-    const auto rgbProfiles = getProfiles(ColorSpace::RGB);
-    const auto cmykProfiles = getProfiles(ColorSpace::CMYK);
-    const auto grayProfiles = getProfiles(ColorSpace::GRAY);
-
     mComboDefRgb->clear();
     mComboDefCmyk->clear();
     mComboDefGray->clear();
+    mComboOutIcc->clear();
+    mProfileIds.clear();
+    mProfilesReady = false;
 
-    QIcon iconPrint = QIcon::fromTheme("document-print");
-    if (iconPrint.isNull()) { iconPrint = QIcon::fromTheme("document-print-symbolic"); }
     QIcon iconDef = QIcon::fromTheme("applications-graphics");
     if (iconDef.isNull()) { iconDef = QIcon::fromTheme("applications-graphics-symbolic"); }
 
-    for (const QString &icc: rgbProfiles) {
-        mComboDefRgb->addItem(iconDef, getProfileName(icc), icc);
-    }
-    for (const QString &icc: cmykProfiles) {
-        mComboDefCmyk->addItem(iconDef, getProfileName(icc), icc);
-        mComboOutIcc->addItem(iconPrint, getProfileName(icc), icc);
-    }
-    for (const QString &icc: grayProfiles) {
-        mComboDefGray->addItem(iconDef, getProfileName(icc), icc);
-        mComboOutIcc->addItem(iconPrint, getProfileName(icc), icc);
-    }
-
     mComboRenderIntent->addItem(iconDef, tr("Perceptual"), 0);
     mComboRenderIntent->addItem(iconDef, tr("Relative Colorimetric"), 1);
     mComboRenderIntent->addItem(iconDef, tr("Saturation"), 2);
     mComboRenderIntent->addItem(iconDef, tr("Absolute Colorimetric"), 3);
+
+    mComboPreset->addItem(iconDef, tr("High-end Press"), CyanPDFCore::Preset::Press);
+    mComboPreset->addItem(iconDef, tr("Digital Press"), CyanPDFCore::Preset::Digital);
+    mComboPreset->addItem(iconDef, tr("Proof"), CyanPDFCore::Preset::Proof);
+
+    CyanPDFProfiles::discover(mProfilePool,
+                              this,
+                              [this](const CyanPDFProfiles::Profile &profile, int rank) {
+        if (!CyanPDFProfiles::isUsable(profile)) { return; }
+        addProfile(profile.path,
+                   profile.description.isEmpty() ? profile.path : profile.description,
+                   profile.id,
+                   profile.colorspace,
+                   rank);
+    }, [this]() {
+        mProfilesReady = true;
+        qCInfo(lcStartup) << "profiles ready in" << mStartupTimer.elapsed() << "ms," << mProfileIds.count() << "profiles";
+        if (mSettingsReady) { applyDefaultProfiles(); }
+    });
 }
 
-void CyanPDF::readSettings()
+void CyanPDF::addProfile(const QString &profile,
+                         const QString &name,
+                         const QString &id,
+                         const int &colorspace,
+                         const int &rank)
 {
-    QSettings settings;
-    settings.beginGroup("cyanpdf");
+    const auto existing = mProfileIds.constFind(id);
+    if (existing != mProfileIds.constEnd()) {
+        if (existing->first < rank ||
+            (existing->first == rank && existing->second <= profile)) { return; }
+        const QString duplicate = existing->second;
+        mProfileIds.insert(id, {rank, profile});
+        for (const auto box : {mComboDefRgb, mComboDefCmyk, mComboDefGray, mComboOutIcc}) {
+            const int index = box->findData(duplicate);
+            if (index != -1) { box->setItemData(index, profile); }
+        }
+        return;
+    }
+    mProfileIds.insert(id, {rank, profile});
 
-    if (settings.value("geometry").isValid()) {
-        restoreGeometry(settings.value("geometry").toByteArray());
+    QIcon iconPrint = QIcon::fromTheme("document-print");
+    if (iconPrint.isNull()) { iconPrint = QIcon::fromTheme("document-print-symbolic"); }
+    QIcon iconDef = QIcon::fromTheme("applications-graphics");
+    if (iconDef.isNull()) { iconDef = QIcon::fromTheme("applications-graphics-symbolic"); }
+
+    switch (colorspace) {
+    case CyanPDFCore::ColorSpace::RGB:
+        insertProfile(mComboDefRgb, iconDef, name, profile, id);
+        break;
+    case CyanPDFCore::ColorSpace::CMYK:
+        insertProfile(mComboDefCmyk, iconDef, name, profile, id);
+        insertProfile(mComboOutIcc, iconPrint, name, profile, id);
+        break;
+    case CyanPDFCore::ColorSpace::GRAY:
+        insertProfile(mComboDefGray, iconDef, name, profile, id);
+        insertProfile(mComboOutIcc, iconPrint, name, profile, id);
+        break;
+    default:;
     }
+}
 
-    if (settings.value("rgb").isValid()) {
-        {
-            int index = mComboDefRgb->findData(settings.value("rgb").toString());
-            if (index != -1) { mComboDefRgb->setCurrentIndex(index); }
-        }
-    } else {
-        {
-            int index = mComboDefRgb->findText("Adobe RGB (1998)");
+void CyanPDF::insertProfile(QComboBox *box,
+                            const QIcon &icon,
+                            const QString &name,
+                            const QString &profile,
+                            const QString &id)
+{
+    int index = 0;
+    while (index < box->count() &&
+           QString::localeAwareCompare(box->itemText(index), name) <= 0) { ++index; }
+    box->insertItem(index, icon, name, profile);
+
+    const auto pending = mPendingProfiles.constFind(box);
+    if (pending != mPendingProfiles.constEnd() &&
+        (pending.value() == id || pending.value() == profile)) {
+        box->setCurrentIndex(index);
+        mPendingProfiles.remove(box);
+        mSelectedProfiles.insert(box);
+    }
+}
+
+int CyanPDF::findProfile(QComboBox *box,
+                         const QString &profile)
+{
+    if (!box) { return -1; }
+    int index = box->findData(profile);
+    if (index != -1) { return index; }
+    const QString id = CyanPDFProfiles::getProfile(profile).id;
+    if (id.isEmpty()) { return -1; }
+    for (int i = 0; i < box->count(); ++i) {
+        if (CyanPDFProfiles::getProfile(box->itemData(i).toString()).id == id) { return i; }
+    }
+    return -1;
+}
+
+void CyanPDF::applyDefaultProfiles()
+{
+    mPendingProfiles.clear();
+
+    if (!mSelectedProfiles.contains(mComboDefRgb)) {
+        int index = mComboDefRgb->findText("Adobe RGB (1998)");
+        if (index != -1) { mComboDefRgb->setCurrentIndex(index); }
+        else {
+            index = mComboDefRgb->findText("sRGB");
             if (index != -1) { mComboDefRgb->setCurrentIndex(index); }
             else {
-                index = mComboDefRgb->findText("sRGB");
+                index = mComboDefRgb->findText("Artifex PS RGB Profile");
                 if (index != -1) { mComboDefRgb->setCurrentIndex(index); }
-                else {
-                    index = mComboDefRgb->findText("Artifex PS RGB Profile");
-                    if (index != -1) { mComboDefRgb->setCurrentIndex(index); }
-                }
             }
         }
     }
-    if (settings.value("cmyk").isValid()) {
-        {
-            int index = mComboDefCmyk->findData(settings.value("cmyk").toString());
-            if (index != -1) { mComboDefCmyk->setCurrentIndex(index); }
-        }
-    } else {
-        {
-            int index = mComboDefCmyk->findText("ISO Coated v2 (ECI)");
+    if (!mSelectedProfiles.contains(mComboDefCmyk)) {
+        int index = mComboDefCmyk->findText("ISO Coated v2 (ECI)");
+        if (index != -1) { mComboDefCmyk->setCurrentIndex(index); }
+        else {
+            index = mComboDefCmyk->findText("U.S. Web Coated (SWOP) v2");
             if (index != -1) { mComboDefCmyk->setCurrentIndex(index); }
             else {
-                index = mComboDefCmyk->findText("U.S. Web Coated (SWOP) v2");
+                index = mComboDefCmyk->findText("Artifex PS CMYK Profile");
                 if (index != -1) { mComboDefCmyk->setCurrentIndex(index); }
-                else {
-                    index = mComboDefCmyk->findText("Artifex PS CMYK Profile");
-                    if (index != -1) { mComboDefCmyk->setCurrentIndex(index); }
-                }
             }
         }
     }
-    if (settings.value("gray").isValid()) {
-        {
-            int index = mComboDefGray->findData(settings.value("gray").toString());
-            if (index != -1) { mComboDefGray->setCurrentIndex(index); }
-        }
-    } else {
-        {
-            int index = mComboDefGray->findText("Gray");
+    if (!mSelectedProfiles.contains(mComboDefGray)) {
+        int index = mComboDefGray->findText("Gray");
+        if (index != -1) { mComboDefGray->setCurrentIndex(index); }
+        else {
+            index = mComboDefGray->findText("Artifex PS Gray Profile");
             if (index != -1) { mComboDefGray->setCurrentIndex(index); }
-            else {
-                index = mComboDefGray->findText("Artifex PS Gray Profile");
-                if (index != -1) { mComboDefGray->setCurrentIndex(index); }
-            }
         }
     }
-    if (settings.value("output").isValid()) {
-        {
-            int index = mComboOutIcc->findData(settings.value("output").toString());
-            if (index != -1) { mComboOutIcc->setCurrentIndex(index); }
-        }
-    } else {
-        {
-            int index = mComboOutIcc->findText(mComboDefCmyk->currentText());
-            if (index != -1) { mComboOutIcc->setCurrentIndex(index); }
+    if (!mSelectedProfiles.contains(mComboOutIcc)) {
+        int index = mComboOutIcc->findText(mComboDefCmyk->currentText());
+        if (index != -1) { mComboOutIcc->setCurrentIndex(index); }
+    }
+}
+
+void CyanPDF::readSettings()
+{
+    QSettings settings;
+    settings.beginGroup("cyanpdf");
+
+    if (settings.value("geometry").isValid()) {
+        restoreGeometry(settings.value("geometry").toByteArray());
+    }
+
+    for (const auto box : {mComboDefRgb, mComboDefCmyk, mComboDefGray, mComboOutIcc}) {
+        const QString profile = settings.value(box->objectName()).toString();
+        if (profile.isEmpty()) { continue; }
+        const int index = findProfile(box, profile);
+        if (index != -1) {
+            box->setCurrentIndex(index);
+            mSelectedProfiles.insert(box);
+        } else {
+            const QString id = CyanPDFProfiles::getProfile(profile).id;
+            mPendingProfiles.insert(box, id.isEmpty() ? profile : id);
         }
     }
 
     mComboRenderIntent->setCurrentIndex(settings.value("intent", 1).toInt());
+    mComboPreset->setCurrentIndex(settings.value("preset", CyanPDFCore::Preset::Press).toInt());
     mCheckBlackPoint->setChecked(settings.value("blackpont", true).toBool());
     mCheckOverrideIcc->setChecked(settings.value("overrideIcc", true).toBool());
+    mInkSpin->setValue(settings.value("inkLimit", CYANPDF_INK_LIMIT).toInt());
 
     settings.endGroup();
 
@@ -612,12 +722,27 @@ void CyanPDF::readSettings()
         settings.setValue("overrideIcc", state == Qt::Checked ? true : false);
         settings.endGroup();
     });
+    connect(mInkSpin, &QSpinBox::valueChanged,
+            this, [this](int value) {
+        QSettings settings;
+        settings.beginGroup("cyanpdf");
+        settings.setValue("inkLimit", value);
+        settings.endGroup();
+        if (!mInkReport.valid) { return; }
+        if (!mHeatmap.isNull()) { mHeatmap.setColorTable(CyanPDFInk::getHeatmapColors(value)); }
+        showInk();
+        if (mCheckInk->isChecked()) { updatePreview(); }
+    });
 
     connectCombobox(mComboDefRgb);
     connectCombobox(mComboDefCmyk);
     connectCombobox(mComboDefGray);
     connectCombobox(mComboOutIcc);
     connectCombobox(mComboRenderIntent);
+    connectCombobox(mComboPreset);
+
+    mSettingsReady = true;
+    if (mProfilesReady) { applyDefaultProfiles(); }
 }
 
 void CyanPDF::writeSettings()
@@ -667,8 +792,10 @@ const QString CyanPDF::getLastSavePath()
 void CyanPDF::connectCombobox(QComboBox *box)
 {
     if (!box) { return; }
-    connect(box, &QComboBox::currentIndexChanged,
+    connect(box, &QComboBox::activated,
             this, [this, box](int index) {
+        mPendingProfiles.remove(box);
+        mSelectedProfiles.insert(box);
         const auto val = box->itemData(index).toString();
         QSettings settings;
         settings.beginGroup("cyanpdf");
@@ -679,9 +806,46 @@ void CyanPDF::connectCombobox(QComboBox *box)
 
 void CyanPDF::loadPDF(const QString &filename)
 {
-    if (!isPDF(filename)) { return; }
+    CyanPDFTrace::Span span("loadPDF", filename);
+    if (!CyanPDFCore::isPDF(filename)) { return; }
 
     mSpecsList->clear();
+    mThumbs->clear();
+    mLabel->clear();
+    mPageCache.clear();
+    mPageRequests.clear();
+    mThumbRequests.clear();
+    mRequestTimes.clear();
+    mThumbsDone.clear();
+    mPage = -1;
+    if (mPreflightWatcher) {
+        disconnect(mPreflightWatcher, nullptr, this, nullptr);
+        mPreflightWatcher->deleteLater();
+        mPreflightWatcher = nullptr;
+    }
+    if (mVerifyWatcher) {
+        disconnect(mVerifyWatcher, nullptr, this, nullptr);
+        mVerifyWatcher->deleteLater();
+        mVerifyWatcher = nullptr;
+    }
+    if (mInkWatcher) {
+        disconnect(mInkWatcher, nullptr, this, nullptr);
+        mInkWatcher->deleteLater();
+        mInkWatcher = nullptr;
+    }
+    mInkReport = CyanPDFInk::Report();
+    mInkFile.clear();
+    clearHeatmap();
+    mCheckInk->setChecked(false);
+    mCheckInk->setEnabled(false);
+    mButtonPrev->setEnabled(false);
+    mButtonNext->setEnabled(false);
+    {
+        const QSignalBlocker blocker(mPageSpin);
+        mPageSpin->setRange(0, 0);
+        mPageSpin->setSuffix(QString());
+        mPageSpin->setEnabled(false);
+    }
     mDocument->close();
     mFilename.clear();
 
@@ -689,6 +853,7 @@ void CyanPDF::loadPDF(const QString &filename)
 
     if (mDocument->load(filename) == QPdfDocument::Error::None) {
         mFilename = filename;
+        CyanPDFDigest::prefetch(filename);
 
         QString title = mDocument->metaData(QPdfDocument::MetaDataField::Title).toString();
         QString subject = mDocument->metaData(QPdfDocument::MetaDataField::Subject).toString();
@@ -743,26 +908,277 @@ void CyanPDF::loadPDF(const QString &filename)
             mSpecsList->addTopLevelItem(item);
         }
 
+        mPreflightWatcher = new QFutureWatcher<CyanPDFPreflight::Report>(this);
+        connect(mPreflightWatcher, &QFutureWatcher<CyanPDFPreflight::Report>::finished,
+                this, [this]() {
+            showPreflight(mPreflightWatcher->result());
+            mPreflightWatcher->deleteLater();
+            mPreflightWatcher = nullptr;
+        });
+        mPreflightWatcher->setFuture(QtConcurrent::run([filename]() {
+            return CyanPDFPreflight::getReport(filename);
+        }));
+
         mRenderer->setDocument(mDocument);
+        mThumbRenderer->setDocument(mDocument);
 
-        connect(mRenderer, &QPdfPageRenderer::pageRendered,
-                this, [this](int pageNumber,
-                             QSize imageSize,
-                             const QImage &image,
-                             QPdfDocumentRenderOptions options,
-                             quint64 requestId) {
-            if (!image.isNull()) {
-                mLabel->setPixmap(QPixmap::fromImage(image.scaled(mLabel->size(),
-                                                                  Qt::KeepAspectRatio,
-                                                                  Qt::SmoothTransformation)));
-            }
-        });
-        mRenderer->requestPage(0, mDocument->pagePointSize(0).toSize());
+        for (int i = 0; i < pages; ++i) {
+            const auto item = new QListWidgetItem(QString::number(i + 1), mThumbs);
+            item->setTextAlignment(Qt::AlignCenter);
+            item->setSizeHint(QSize(CYANPDF_THUMB_SIZE + 12, CYANPDF_THUMB_SIZE + 24));
+        }
+        {
+            const QSignalBlocker blocker(mPageSpin);
+            mPageSpin->setRange(1, qMax(1, pages));
+            mPageSpin->setSuffix(tr(" of %1").arg(pages));
+            mPageSpin->setEnabled(pages > 1);
+        }
+        showPage(0);
+        QTimer::singleShot(0, this, &CyanPDF::requestThumbnails);
+    }
+}
+
+void CyanPDF::showPreflight(const CyanPDFPreflight::Report &report)
+{
+    const auto addItem = [this](const QString &key,
+                                const QString &value,
+                                const QString &tooltip = QString()) {
+        const auto item = new QTreeWidgetItem(mSpecsList);
+        item->setText(0, key);
+        item->setText(1, value);
+        item->setToolTip(1, tooltip.isEmpty() ? value : tooltip);
+        mSpecsList->addTopLevelItem(item);
+    };
+
+    if (!report.valid) {
+        addItem(tr("Preflight"), tr("Unable to read document structure"));
+        return;
+    }
+    if (report.encrypted) {
+        addItem(tr("Encrypted"), tr("Yes"));
+        return;
+    }
+    addItem(tr("Version"), report.version);
+    addItem(tr("PDF/X"), report.pdfx.isEmpty() ? tr("No") : report.pdfx);
+    if (!report.outputIntents.isEmpty()) { addItem(tr("Output Intent"), report.outputIntents.join(", ")); }
+    addItem(tr("Color Spaces"), report.colorspaces.join(", "));
+    addItem(tr("Images"), QString::number(report.images));
+    addItem(tr("ICC Profiles"), QString::number(report.iccProfiles));
+    addItem(tr("Fonts"),
+            report.unembeddedFonts.isEmpty() ? tr("Embedded") : tr("%1 not embedded").arg(report.unembeddedFonts.count()),
+            report.unembeddedFonts.join("\n"));
+
+    QString reason;
+    const bool compliant = CyanPDFPreflight::isCompliant(report,
+                                                         mComboOutIcc->currentData().toString(),
+                                                         mComboDefGray->currentData().toString(),
+                                                         mComboDefCmyk->currentData().toString(),
+                                                         mComboRenderIntent->currentData().toInt(),
+                                                         mCheckBlackPoint->isChecked(),
+                                                         mCheckOverrideIcc->isChecked(),
+                                                         mComboPreset->currentData().toInt(),
+                                                         &reason);
+    addItem(tr("Pass-through"), compliant ? tr("Yes") : tr("No"), reason);
+}
+
+void CyanPDF::showResult(const QString &inputFile,
+                         const QString &filename,
+                         const qint64 &elapsed)
+{
+    const qint64 input = QFileInfo(inputFile).size();
+    const qint64 output = QFileInfo(filename).size();
+    QString size = locale().formattedDataSize(output);
+    if (input > 0) { size.append(QString(" (%1%)").arg(qRound(100.0 * output / input))); }
+    const QStringList values = {
+        size,
+        tr("%1 s").arg(QString::number(elapsed / 1000.0, 'f', 2))
+    };
+    const QStringList keys = {tr("Output Size"), tr("Output Time")};
+    for (int i = 0; i < keys.count(); ++i) { setSpecsItem(keys.at(i), values.at(i), filename); }
+}
+
+void CyanPDF::showVerify(const QString &filename,
+                         const QStringList &problems)
+{
+    setSpecsItem(tr("Output Check"),
+                 problems.isEmpty() ? tr("PDF/X OK") : tr("%1 problem(s)").arg(problems.count()),
+                 problems.isEmpty() ? filename : problems.join("\n"));
+    if (problems.isEmpty()) { return; }
+    QMessageBox::warning(this, tr("Output Check Failed"),
+                         tr("%1 did not pass the PDF/X check:<br><br>%2").arg(filename.toHtmlEscaped(),
+                                                                               problems.join("<br>").toHtmlEscaped()));
+}
+
+void CyanPDF::showInk()
+{
+    if (!mInkReport.valid) {
+        setSpecsItem(tr("Total Ink"), tr("Unable to measure"), QString());
+        return;
+    }
+    const int limit = mInkSpin->value();
+    QStringList pages;
+    QStringList over;
+    for (int i = 0; i < mInkReport.pages.count(); ++i) {
+        const auto &page = mInkReport.pages.at(i);
+        pages << tr("Page %1: %2% max, %3% average").arg(i + 1)
+                                                    .arg(qRound(page.max))
+                                                    .arg(qRound(page.average));
+        if (page.max > limit) { over << QString::number(i + 1); }
+    }
+    setSpecsItem(tr("Total Ink"),
+                 tr("%1% max (page %2), %3% average").arg(qRound(mInkReport.max))
+                                                     .arg(mInkReport.maxPage + 1)
+                                                     .arg(qRound(mInkReport.average)),
+                 pages.join("\n"));
+    setSpecsItem(tr("Ink Limit"),
+                 over.isEmpty() ? tr("OK (%1%)").arg(limit) : tr("%1 page(s) over %2%").arg(over.count()).arg(limit),
+                 over.isEmpty() ? QString() : tr("Pages: %1").arg(over.join(", ")));
+}
+
+void CyanPDF::requestHeatmap(const int &page)
+{
+    if (mInkFile.isEmpty() || page < 0) { return; }
+    if (mHeatmapWatcher) {
+        if (mHeatmapWatcher->property("page").toInt() == page) { return; }
+        disconnect(mHeatmapWatcher, nullptr, this, nullptr);
+        mHeatmapWatcher->deleteLater();
+    }
+    // only the map of the page on display is kept, a whole document of them does not fit in memory
+    mHeatmapWatcher = new QFutureWatcher<QImage>(this);
+    mHeatmapWatcher->setProperty("page", page);
+    connect(mHeatmapWatcher, &QFutureWatcher<QImage>::finished,
+            this, [this, page]() {
+        mHeatmap = mHeatmapWatcher->result();
+        mHeatmapPage = page;
+        mHeatmapWatcher->deleteLater();
+        mHeatmapWatcher = nullptr;
+        if (!mHeatmap.isNull()) { mHeatmap.setColorTable(CyanPDFInk::getHeatmapColors(mInkSpin->value())); }
+        if (mCheckInk->isChecked() && mPage == page) { updatePreview(); }
+    });
+    const QString filename = mInkFile;
+    const int limit = mInkSpin->value();
+    mHeatmapWatcher->setFuture(QtConcurrent::run([filename, page, limit]() {
+        return CyanPDFInk::getHeatmap(filename, page, limit);
+    }));
+}
+
+void CyanPDF::clearHeatmap()
+{
+    if (mHeatmapWatcher) {
+        disconnect(mHeatmapWatcher, nullptr, this, nullptr);
+        mHeatmapWatcher->deleteLater();
+        mHeatmapWatcher = nullptr;
+    }
+    mHeatmap = QImage();
+    mHeatmapPage = -1;
+}
+
+void CyanPDF::setSpecsItem(const QString &key,
+                           const QString &value,
+                           const QString &tooltip)
+{
+    const auto found = mSpecsList->findItems(key, Qt::MatchExactly, 0);
+    const auto item = found.isEmpty() ? new QTreeWidgetItem(mSpecsList) : found.first();
+    item->setText(0, key);
+    item->setText(1, value);
+    item->setToolTip(1, tooltip);
+    if (found.isEmpty()) { mSpecsList->addTopLevelItem(item); }
+}
+
+void CyanPDF::showPage(const int &page)
+{
+    if (mFilename.isEmpty() || page < 0 || page >= mDocument->pageCount()) { return; }
+    mPage = page;
+    {
+        const QSignalBlocker spinBlocker(mPageSpin);
+        const QSignalBlocker thumbsBlocker(mThumbs);
+        mPageSpin->setValue(page + 1);
+        mThumbs->setCurrentRow(page);
+    }
+    mButtonPrev->setEnabled(page > 0);
+    mButtonNext->setEnabled(page < mDocument->pageCount() - 1);
+
+    const QImage *image = mPageCache.object(page);
+    const QSize size = getPageSize(page, mLabel->size() * mLabel->devicePixelRatioF());
+    if (image && image->size() == size) { displayPage(*image); }
+    else { requestPage(page); }
+
+    for (int i = 1; i <= CYANPDF_PREVIEW_PREFETCH; ++i) {
+        requestPage(page + i);
+        requestPage(page - i);
+    }
+}
+
+void CyanPDF::displayPage(const QImage &image)
+{
+    QImage page = image;
+    if (mCheckProof->isChecked()) {
+        CyanPDFTrace::Span span("getProof");
+        page = CyanPDFProof::getProof(image,
+                                      mComboOutIcc->currentData().toString(),
+                                      mComboRenderIntent->currentData().toInt(),
+                                      mCheckBlackPoint->isChecked(),
+                                      mCheckGamut->isChecked());
+    }
+    if (mCheckInk->isChecked() && mPage >= 0 && mPage < mInkReport.pages.count()) {
+        if (mHeatmapPage != mPage) { requestHeatmap(mPage); }
+        else if (!mHeatmap.isNull()) {
+            page = page.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+            QPainter painter(&page);
+            painter.drawImage(QRectF(QPointF(0, 0), page.deviceIndependentSize()), mHeatmap);
+        }
+    }
+    mLabel->setPixmap(QPixmap::fromImage(page));
+}
+
+void CyanPDF::updatePreview()
+{
+    if (mPage < 0) { return; }
+    const QImage *image = mPageCache.object(mPage);
+    if (image) { displayPage(*image); }
+}
+
+void CyanPDF::requestPage(const int &page)
+{
+    if (page < 0 || page >= mDocument->pageCount()) { return; }
+    const QSize size = getPageSize(page, mLabel->size() * mLabel->devicePixelRatioF());
+    const QImage *image = mPageCache.object(page);
+    if ((image && image->size() == size) ||
+        mPageRequests.values().contains(page)) { return; }
+    const qint64 requested = CyanPDFTrace::isEnabled() ? CyanPDFTrace::now() : -1;
+    const quint64 requestId = mRenderer->requestPage(page, size);
+    mPageRequests.insert(requestId, page);
+    if (requested >= 0) { mRequestTimes.insert(requestId, requested); }
+}
+
+void CyanPDF::requestThumbnails()
+{
+    if (mFilename.isEmpty()) { return; }
+    const QRect view = mThumbs->viewport()->rect();
+    const QSize bounds = mThumbs->iconSize() * mThumbs->devicePixelRatioF();
+    const QList<int> pending = mThumbRequests.values();
+    for (int i = 0; i < mThumbs->count(); ++i) {
+        const QRect rect = mThumbs->visualItemRect(mThumbs->item(i));
+        if (rect.left() > view.right()) { break; }
+        if (!rect.intersects(view) || mThumbsDone.contains(i) || pending.contains(i)) { continue; }
+        const qint64 requested = CyanPDFTrace::isEnabled() ? CyanPDFTrace::now() : -1;
+        const quint64 requestId = mThumbRenderer->requestPage(i, getPageSize(i, bounds));
+        mThumbRequests.insert(requestId, i);
+        if (requested >= 0) { mRequestTimes.insert(requestId, requested); }
     }
 }
 
+const QSize CyanPDF::getPageSize(const int &page,
+                                 const QSize &bounds)
+{
+    const QSizeF size = mDocument->pagePointSize(page);
+    if (size.isEmpty()) { return bounds; }
+    return size.scaled(bounds, Qt::KeepAspectRatio).toSize();
+}
+
 void CyanPDF::savePDF(const QString &filename)
 {
+    CyanPDFTrace::Span span("savePDF", filename);
     if (filename.trimmed().isEmpty()) {
         QMessageBox::warning(this, tr("Missing filename"),
                              tr("Missing output filename."));
@@ -770,80 +1186,231 @@ void CyanPDF::savePDF(const QString &filename)
     }
     setLastSavePath(QFileInfo(filename).absolutePath());
 
-    if (!isPDF(mFilename)) {
+    if (!CyanPDFCore::isPDF(mFilename)) {
         QMessageBox::warning(this, tr("Missing PDF"),
                              tr("No PDF document loaded."));
         return;
     }
+    if (mJob) {
+        QMessageBox::warning(this, tr("Conversion running"),
+                             tr("A conversion is already running."));
+        return;
+    }
+
+    CyanPDFJob::Settings settings;
+    if (!getSettings(&settings)) { return; }
+    settings.inputFile = mFilename;
+    settings.outputFile = filename;
+
+    mJob = new CyanPDFJob(settings, this);
+    connect(mJob, &CyanPDFJob::progress,
+            this, [this](int page, int pages) {
+        mProgress->setMaximum(pages > 0 ? pages : 0);
+        mProgress->setValue(page);
+    });
+    connect(mJob, &CyanPDFJob::finished,
+            this, [this](bool success, const QString &error) {
+        const QString input = mJob->settings().inputFile;
+        const QString output = mJob->settings().outputFile;
+        const QString outputIcc = mJob->settings().outputIcc;
+        const QString log = mJob->log();
+        const bool canceled = mJob->isCanceled();
+        const qint64 elapsed = mJob->elapsed();
+        mJob->deleteLater();
+        mJob = nullptr;
+        mProgress->setVisible(false);
+        mButtonCancel->setVisible(false);
+        mButtonSave->setEnabled(true);
+        // another document may have been opened while converting, its specs are not ours
+        const bool current = input == mFilename;
+        if (success) {
+            if (current) { showResult(input, output, elapsed); }
+            QDesktopServices::openUrl(QUrl::fromLocalFile(output));
+            if (current) {
+                if (mVerifyWatcher) {
+                    disconnect(mVerifyWatcher, nullptr, this, nullptr);
+                    mVerifyWatcher->deleteLater();
+                }
+                mVerifyWatcher = new QFutureWatcher<QStringList>(this);
+                connect(mVerifyWatcher, &QFutureWatcher<QStringList>::finished,
+                        this, [this, input, output]() {
+                    const QStringList problems = mVerifyWatcher->result();
+                    mVerifyWatcher->deleteLater();
+                    mVerifyWatcher = nullptr;
+                    if (input == mFilename) { showVerify(output, problems); }
+                });
+                mVerifyWatcher->setFuture(QtConcurrent::run([output, outputIcc]() {
+                    return CyanPDFPreflight::verify(output, outputIcc);
+                }));
+            }
+
+            // the heat map is drawn over the open document's pages, so it must be this output
+            if (current) {
+                if (mInkWatcher) {
+                    disconnect(mInkWatcher, nullptr, this, nullptr);
+                    mInkWatcher->deleteLater();
+                }
+                clearHeatmap();
+                mInkFile = output;
+                mInkWatcher = new QFutureWatcher<CyanPDFInk::Report>(this);
+                connect(mInkWatcher, &QFutureWatcher<CyanPDFInk::Report>::finished,
+                        this, [this, input]() {
+                    const CyanPDFInk::Report report = mInkWatcher->result();
+                    mInkWatcher->deleteLater();
+                    mInkWatcher = nullptr;
+                    if (input != mFilename) { return; }
+                    mInkReport = report;
+                    mCheckInk->setEnabled(mInkReport.valid);
+                    showInk();
+                    if (mCheckInk->isChecked()) { updatePreview(); }
+                });
+                const int limit = mInkSpin->value();
+                mInkWatcher->setFuture(QtConcurrent::run([output, limit]() {
+                    return CyanPDFInk::getReport(output, limit);
+                }));
+            }
+        }
+        else if (!canceled) {
+            QMessageBox::warning(this, tr("Failed to Convert"),
+                                 tr("Failed converting PDF: %1<br><br><pre>%2</pre>").arg(error, log.toHtmlEscaped()));
+        }
+    });
+
+    mProgress->setRange(0, 0);
+    mProgress->setVisible(true);
+    mButtonCancel->setVisible(true);
+    mButtonSave->setEnabled(false);
+    mJob->start();
+}
+
+const bool CyanPDF::getSettings(CyanPDFJob::Settings *settings)
+{
     const QString defRgb = mComboDefRgb->currentData().toString();
-    if (!isICC(defRgb)) {
+    if (!CyanPDFCore::isICC(defRgb)) {
         QMessageBox::warning(this, tr("Missing RGB Profile"),
                              tr("Missing default RGB profile."));
-        return;
+        return false;
     }
     const QString defCmyk = mComboDefCmyk->currentData().toString();
-    if (!isICC(defCmyk)) {
+    if (!CyanPDFCore::isICC(defCmyk)) {
         QMessageBox::warning(this, tr("Missing CMYK Profile"),
                              tr("Missing default CMYK profile."));
-        return;
+        return false;
     }
     const QString defGray = mComboDefGray->currentData().toString();
-    if (!isICC(defGray)) {
+    if (!CyanPDFCore::isICC(defGray)) {
         QMessageBox::warning(this, tr("Missing GRAY Profile"),
                              tr("Missing default GRAY profile."));
-        return;
+        return false;
     }
     const QString outIcc = mComboOutIcc->currentData().toString();
-    if (!isICC(outIcc)) {
+    if (!CyanPDFCore::isICC(outIcc)) {
         QMessageBox::warning(this, tr("Missing Output Profile"),
                              tr("Missing output (CMYK/GRAY) profile."));
-        return;
+        return false;
     }
 
-    const int intent = mComboRenderIntent->currentData().toInt();
-    const bool blackPoint = mCheckBlackPoint->isChecked();
-    const bool overrideIcc = mCheckOverrideIcc->isChecked();
-
-    const QString gsPath = getGhostscript();
-    const QString gsVer = getGhostscriptVersion();
+    const QString gsPath = CyanPDFCore::getGhostscript();
+    const QString gsVer = CyanPDFCore::getGhostscriptVersion();
     if (gsPath.trimmed().isEmpty() || gsVer.trimmed().isEmpty()) {
         QMessageBox::warning(this, tr("Missing Ghostscript"),
                              tr("Ghostscript not found, please install."));
-        return;
+        return false;
     }
 
-    const QString ps = getPostscript(mFilename, outIcc);
-    if (!QFile::exists(ps)) {
-        QMessageBox::warning(this, tr("Missing Postscript"),
-                             tr("Unable to create postscript file."));
-        return;
-    }
+    settings->outputIcc = outIcc;
+    settings->defRgbIcc = defRgb;
+    settings->defGrayIcc = defGray;
+    settings->defCmykIcc = defCmyk;
+    settings->renderIntent = mComboRenderIntent->currentData().toInt();
+    settings->blackPoint = mCheckBlackPoint->isChecked();
+    settings->overrideIcc = mCheckOverrideIcc->isChecked();
+    settings->preset = mComboPreset->currentData().toInt();
+    return true;
+}
 
-    const QStringList args = getConvertArgs(mFilename,
-                                            filename,
-                                            outIcc,
-                                            defRgb,
-                                            defGray,
-                                            defCmyk,
-                                            getColorspace(outIcc),
-                                            intent,
-                                            blackPoint,
-                                            overrideIcc);
-    if (args.count() < 1) {
-        QMessageBox::warning(this, tr("Missing Arguments"),
-                             tr("Unable to generate Ghostscript arguments."));
-        return;
+void CyanPDF::cancelPDF()
+{
+    if (mJob) { mJob->cancel(); }
+}
+
+void CyanPDF::queuePDFs(const QStringList &filenames)
+{
+    if (filenames.isEmpty()) { return; }
+    CyanPDFJob::Settings settings;
+    if (!getSettings(&settings)) { return; }
+    const QString folder = QFileDialog::getExistingDirectory(this,
+                                                             tr("Output Folder"),
+                                                             getLastSavePath());
+    if (folder.isEmpty()) { return; }
+    setLastSavePath(folder);
+    mQueueList->setVisible(true);
+
+    // documents with the same name would overwrite each other, unfinished ones included
+    QSet<QString> outputs;
+    for (const auto item : std::as_const(mQueueItems)) {
+        if (!item->data(0, Qt::UserRole + 2).toBool()) { outputs.insert(item->data(0, Qt::UserRole + 3).toString()); }
     }
 
-    QProcess proc;
-    proc.start(gsPath, args);
-    if (proc.waitForStarted()) {
-        proc.waitForFinished();
-        QByteArray result = proc.readAll();
-        if (proc.exitCode() == 0) { if (isPDF(filename)) { QDesktopServices::openUrl(QUrl(filename)); } }
-        else {
-            QMessageBox::warning(this, tr("Failed to Convert"),
-                                 tr("Failed converting PDF.<br><br><pre>%1</pre>").arg(result));
+    for (const QString &filename : filenames) {
+        CyanPDFJob::Settings job = settings;
+        job.id = QString::number(++mQueueSerial);
+        job.inputFile = filename;
+        const QFileInfo info(filename);
+        QString name = info.completeBaseName();
+        if (QFileInfo(QDir(folder).absoluteFilePath(name + ".pdf")) == info) { name.append("-pdfx"); }
+        job.outputFile = QDir(folder).absoluteFilePath(name + ".pdf");
+        for (int i = 2; outputs.contains(job.outputFile); ++i) {
+            job.outputFile = QDir(folder).absoluteFilePath(QString("%1-%2.pdf").arg(name).arg(i));
         }
+        outputs.insert(job.outputFile);
+
+        const auto item = new QTreeWidgetItem(mQueueList);
+        item->setText(0, info.fileName());
+        item->setToolTip(0, filename);
+        item->setText(2, tr("Waiting"));
+        item->setData(0, Qt::UserRole, job.id);
+        item->setData(0, Qt::UserRole + 3, job.outputFile);
+        mQueueList->addTopLevelItem(item);
+        mQueueItems.insert(job.id, item);
+
+        // estimating a large document takes a moment, so it joins the queue once known
+        const auto watcher = new QFutureWatcher<QPair<qint64, int>>(this);
+        connect(watcher, &QFutureWatcher<QPair<qint64, int>>::finished,
+                this, [this, watcher, job]() {
+            const auto cost = watcher->result();
+            watcher->deleteLater();
+            const auto item = mQueueItems.value(job.id);
+            if (!item) { return; }
+            item->setText(1, QString::number(cost.second));
+            mQueue->enqueue(job, cost.first);
+        });
+        watcher->setFuture(QtConcurrent::run([filename]() {
+            int pages = 0;
+            const qint64 cost = CyanPDFQueue::getCost(filename, &pages);
+            return qMakePair(cost, pages);
+        }));
+    }
+}
+
+void CyanPDF::dragEnterEvent(QDragEnterEvent *event)
+{
+    if (event->mimeData()->hasUrls()) { event->acceptProposedAction(); }
+}
+
+void CyanPDF::dropEvent(QDropEvent *event)
+{
+    QStringList filenames;
+    for (const QUrl &url : event->mimeData()->urls()) {
+        const QString filename = url.toLocalFile();
+        if (CyanPDFCore::isPDF(filename)) { filenames << filename; }
+    }
+    if (filenames.isEmpty()) { return; }
+    event->acceptProposedAction();
+    if (filenames.count() == 1) {
+        loadPDF(filenames.first());
+        return;
     }
+    // the folder dialog must not block the drag source
+    QTimer::singleShot(0, this, [this, filenames]() { queuePDFs(filenames); });
 }
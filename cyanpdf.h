@@ -11,8 +11,28 @@
 #include <QComboBox>
 #include <QCheckBox>
 #include <QTreeWidget>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QListWidget>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QCache>
+#include <QImage>
 #include <QPdfDocument>
 #include <QPdfPageRenderer>
+#include <QFutureWatcher>
+#include <QDragEnterEvent>
+#include <QDropEvent>
+
+#include "cyanpdfpreflight.h"
+#include "cyanpdfink.h"
+#include "cyanpdfjob.h"
+
+class CyanPDFQueue;
 
 class ComboBox : public QComboBox
 {
@@ -31,54 +51,22 @@ public:
     CyanPDF(QWidget *parent = nullptr);
     ~CyanPDF();
 
-    enum RenderIntent {
-        Perceptual,
-        Colorimetric,
-        Saturation,
-        AbsoluteColorimetric,
-        NoIntent
-    };
-
-    enum ColorSpace {
-        RGB,
-        CMYK,
-        GRAY,
-        NA
-    };
-
-    const QString getGhostscript(bool pathOnly = false);
-    const QString getGhostscriptVersion();
-
-    const QString getPostscript(const QString &filename,
-                                const QString &profile);
-
-    const QString getCachePath();
-    const QString getChecksum(const QString &filename);
-
-    const QStringList getConvertArgs(const QString &inputFile,
-                                     const QString &outputFile,
-                                     const QString &outputIcc,
-                                     const QString defRgbIcc,
-                                     const QString defGrayIcc,
-                                     const QString defCmykIcc,
-                                     const int &colorSpace = ColorSpace::CMYK,
-                                     const int &renderIntent = RenderIntent::Colorimetric,
-                                     const bool &blackPoint = true,
-                                     const bool &overrideIcc = true);
-
-    const int getColorspace(const QString &profile);
-    const QStringList getProfiles(const int &colorspace);
-    const QString getProfileName(const QString &profile);
-
-    const bool isFileType(const QString &filename,
-                          const QString &mime,
-                          const bool &startsWith = false);
-    const bool isPDF(const QString &filename);
-    const bool isICC(const QString &filename);
-
     void setupWidgets();
 
     void populateComboBoxes();
+    void addProfile(const QString &profile,
+                    const QString &name,
+                    const QString &id,
+                    const int &colorspace,
+                    const int &rank);
+    void insertProfile(QComboBox *box,
+                       const QIcon &icon,
+                       const QString &name,
+                       const QString &profile,
+                       const QString &id);
+    int findProfile(QComboBox *box,
+                    const QString &profile);
+    void applyDefaultProfiles();
 
     void readSettings();
     void writeSettings();
@@ -91,21 +79,88 @@ public:
 
     void connectCombobox(QComboBox *box);
 
+    void showPage(const int &page);
+    void displayPage(const QImage &image);
+    void updatePreview();
+    void requestPage(const int &page);
+    void requestThumbnails();
+    const QSize getPageSize(const int &page,
+                            const QSize &bounds);
+
+    void showPreflight(const CyanPDFPreflight::Report &report);
+    void showResult(const QString &inputFile,
+                    const QString &filename,
+                    const qint64 &elapsed);
+    void showVerify(const QString &filename,
+                    const QStringList &problems);
+    void showInk();
+    void requestHeatmap(const int &page);
+    void clearHeatmap();
+    void setSpecsItem(const QString &key,
+                      const QString &value,
+                      const QString &tooltip);
+
     void loadPDF(const QString &filename);
     void savePDF(const QString &filename);
+    void cancelPDF();
+    const bool getSettings(CyanPDFJob::Settings *settings);
+    void queuePDFs(const QStringList &filenames);
+
+protected:
+    void dragEnterEvent(QDragEnterEvent *event) override;
+    void dropEvent(QDropEvent *event) override;
 
 private:
     QPdfDocument *mDocument;
     QPdfPageRenderer *mRenderer;
+    QPdfPageRenderer *mThumbRenderer;
     QLabel *mLabel;
+    QPushButton *mButtonPrev;
+    QPushButton *mButtonNext;
+    QSpinBox *mPageSpin;
+    QCheckBox *mCheckProof;
+    QCheckBox *mCheckGamut;
+    QCheckBox *mCheckInk;
+    QSpinBox *mInkSpin;
+    QListWidget *mThumbs;
+    QCache<int, QImage> mPageCache;
+    QHash<quint64, int> mPageRequests;
+    QHash<quint64, int> mThumbRequests;
+    QHash<quint64, qint64> mRequestTimes;
+    QSet<int> mThumbsDone;
+    int mPage;
     ComboBox *mComboDefRgb;
     ComboBox *mComboDefCmyk;
     ComboBox *mComboDefGray;
     ComboBox *mComboOutIcc;
     ComboBox *mComboRenderIntent;
+    ComboBox *mComboPreset;
     QCheckBox *mCheckBlackPoint;
     QCheckBox *mCheckOverrideIcc;
     QTreeWidget *mSpecsList;
+    QProgressBar *mProgress;
+    QPushButton *mButtonSave;
+    QPushButton *mButtonCancel;
+    CyanPDFJob *mJob;
+    CyanPDFQueue *mQueue;
+    QTreeWidget *mQueueList;
+    QHash<QString, QTreeWidgetItem*> mQueueItems;
+    int mQueueSerial;
+    QThreadPool *mProfilePool;
+    QFutureWatcher<CyanPDFPreflight::Report> *mPreflightWatcher;
+    QFutureWatcher<QStringList> *mVerifyWatcher;
+    QFutureWatcher<CyanPDFInk::Report> *mInkWatcher;
+    CyanPDFInk::Report mInkReport;
+    QString mInkFile;
+    QFutureWatcher<QImage> *mHeatmapWatcher;
+    QImage mHeatmap;
+    int mHeatmapPage;
+    QElapsedTimer mStartupTimer;
+    QHash<QString, QPair<int, QString>> mProfileIds;
+    QHash<QComboBox*, QString> mPendingProfiles;
+    QSet<QComboBox*> mSelectedProfiles;
+    bool mProfilesReady;
+    bool mSettingsReady;
     QString mFilename;
 };
 
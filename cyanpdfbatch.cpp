@@ -0,0 +1,387 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfbatch.h"
+#include "cyanpdfcache.h"
+#include "cyanpdfpreflight.h"
+#include "cyanpdfink.h"
+#include "cyanpdfresources.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QLocale>
+#include <QSet>
+#include <QSettings>
+#include <QTextStream>
+#include <QThread>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <cstring>
+#include <string>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+CyanPDFBatch::CyanPDFBatch(QObject *parent)
+    : QObject(parent)
+    , mQueue(nullptr)
+    , mWatch(nullptr)
+    , mServer(nullptr)
+    , mStreaming(false)
+    , mVerify(true)
+    , mIdle(false)
+    , mVerifying(0)
+    , mInkLimit(0)
+    , mTotal(0)
+    , mFailed(0)
+{
+}
+
+bool CyanPDFBatch::isBatch(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        // the option name only, so --watch=DIR and --serve=NAME match too
+        const std::string option(argv[i], std::strcspn(argv[i], "="));
+        if (option == "--batch" ||
+            option == "--watch" ||
+            option == "--serve") { return true; }
+    }
+    return false;
+}
+
+const QString CyanPDFBatch::getDefaultProfile(const int &colorspace)
+{
+    QString key;
+    QStringList fallbacks;
+    switch (colorspace) {
+    case CyanPDFCore::ColorSpace::RGB:
+        key = "rgb";
+        fallbacks << "Adobe RGB (1998)" << "sRGB" << "Artifex PS RGB Profile";
+        break;
+    case CyanPDFCore::ColorSpace::CMYK:
+        key = "cmyk";
+        fallbacks << "ISO Coated v2 (ECI)" << "U.S. Web Coated (SWOP) v2" << "Artifex PS CMYK Profile";
+        break;
+    case CyanPDFCore::ColorSpace::GRAY:
+        key = "gray";
+        fallbacks << "Gray" << "Artifex PS Gray Profile";
+        break;
+    default:
+        return QString();
+    }
+
+    QSettings settings;
+    settings.beginGroup("cyanpdf");
+    const QString saved = settings.value(key).toString();
+    settings.endGroup();
+    if (CyanPDFCore::isICC(saved) && CyanPDFCore::getColorspace(saved) == colorspace) { return saved; }
+
+    const QStringList profiles = CyanPDFCore::getProfiles(colorspace);
+    for (const QString &name : fallbacks) {
+        for (const QString &profile : profiles) {
+            if (CyanPDFCore::getProfileName(profile) == name) { return profile; }
+        }
+    }
+    return profiles.isEmpty() ? QString() : profiles.first();
+}
+
+const QString CyanPDFBatch::spoolInput()
+{
+    // Ghostscript needs random access, so stdin is read once. Not named .pdf, or the cache trim could remove it
+    mSpool = std::make_unique<QTemporaryFile>(QString("%1/stdin-XXXXXX.spool").arg(CyanPDFCore::getCachePath()));
+    QFile input;
+    if (!mSpool->open() || !input.open(stdin, QIODevice::ReadOnly)) { return QString(); }
+    while (true) {
+        const QByteArray data = input.read(1024 * 1024);
+        if (data.isEmpty()) { break; }
+        if (mSpool->write(data) != data.size()) { return QString(); }
+    }
+    mSpool->close();
+    return mSpool->size() > 0 ? mSpool->fileName() : QString();
+}
+
+void CyanPDFBatch::finish()
+{
+    if (!mIdle || mVerifying > 0) { return; }
+    QTextStream out(mStreaming ? stderr : stdout);
+    out << tr("%1 of %2 documents converted.").arg(mTotal - mFailed).arg(mTotal) << Qt::endl;
+    QCoreApplication::exit(mFailed > 0 ? ExitFailed : ExitSuccess);
+}
+
+int CyanPDFBatch::exec(const QStringList &arguments)
+{
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(tr("Convert PDF documents to PDF/X without a GUI."));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("inputs", tr("PDF documents or folders to convert."), "[inputs...]");
+    parser.addOptions({
+        {"batch", tr("Run in batch mode.")},
+        {"watch", tr("Watch a folder and convert documents as they are dropped into it."), "folder"},
+        {"serve", tr("Accept JSON jobs on a local socket.")},
+        {"socket", tr("Local socket name used with --serve."), "name", "cyanpdf"},
+        {{"o", "output", "out"}, tr("Output folder."), "folder"},
+        {"done", tr("Folder for converted watch folder documents (default: <watch>/done)."), "folder"},
+        {"error", tr("Folder for failed watch folder documents and their logs (default: <watch>/error)."), "folder"},
+        {"queue-size", tr("Maximum number of watch folder documents waiting for a job (default: 2 x jobs)."), "size"},
+        {"settle", tr("Seconds a watch folder document must stay unchanged before it is picked up."), "seconds", "2"},
+        {"output-icc", tr("Output (CMYK/GRAY) profile."), "profile"},
+        {"rgb-icc", tr("Default RGB profile."), "profile"},
+        {"cmyk-icc", tr("Default CMYK profile."), "profile"},
+        {"gray-icc", tr("Default GRAY profile."), "profile"},
+        {"intent", tr("Rendering intent (0-3)."), "intent", QString::number(CyanPDFCore::RenderIntent::Colorimetric)},
+        {"no-black-point", tr("Disable black point compensation.")},
+        {"no-override-icc", tr("Keep ICC profiles contained in the source documents.")},
+        {"preset", tr("Output preset: press, digital or proof."), "preset", "press"},
+        {{"j", "jobs"}, tr("Number of concurrent Ghostscript processes."), "jobs", QString::number(QThread::idealThreadCount())},
+        {"shards", tr("Split each document into page ranges converted in parallel (0 = one per core)."), "shards", "1"},
+        {"verify-shards", tr("Check that sharded output matches a single-pass conversion page for page.")},
+        {"no-cache", tr("Do not use or store cached conversion results.")},
+        {"no-pass-through", tr("Convert documents that already match the output profile.")},
+        {"no-libgs", tr("Always run the Ghostscript executable instead of libgs.")},
+        {"no-verify", tr("Do not check converted documents for PDF/X compliance.")},
+        {"ink-limit", tr("Measure total ink coverage and fail documents above this limit in percent."), "percent"},
+        {"cache-size", tr("Maximum size of the conversion cache in MiB."), "size"},
+        {"memory-limit", tr("Maximum memory per Ghostscript run in MiB (default: no limit)."), "size"},
+        {"trace", tr("Write timing spans in Chrome trace event format."), "file"}
+    });
+    parser.process(arguments);
+
+    const QString outputDir = parser.value("output");
+    mStreaming = CyanPDFJob::isStream(outputDir);
+    if (outputDir.isEmpty() && !parser.isSet("serve")) {
+        err << tr("Missing output folder (-o).") << Qt::endl;
+        return ExitUsage;
+    }
+    if (mStreaming && (parser.isSet("watch") || parser.isSet("serve"))) {
+        err << tr("Output to stdout is only supported in batch mode.") << Qt::endl;
+        return ExitUsage;
+    }
+    if (!outputDir.isEmpty() && !mStreaming && !QDir().mkpath(outputDir)) {
+        err << tr("Unable to create output folder %1.").arg(outputDir) << Qt::endl;
+        return ExitUsage;
+    }
+
+    CyanPDFJob::Settings defaults;
+    defaults.outputIcc = parser.value("output-icc");
+    defaults.defRgbIcc = parser.isSet("rgb-icc") ? parser.value("rgb-icc") : getDefaultProfile(CyanPDFCore::ColorSpace::RGB);
+    defaults.defCmykIcc = parser.isSet("cmyk-icc") ? parser.value("cmyk-icc") : getDefaultProfile(CyanPDFCore::ColorSpace::CMYK);
+    defaults.defGrayIcc = parser.isSet("gray-icc") ? parser.value("gray-icc") : getDefaultProfile(CyanPDFCore::ColorSpace::GRAY);
+    defaults.blackPoint = !parser.isSet("no-black-point");
+    defaults.overrideIcc = !parser.isSet("no-override-icc");
+    defaults.shards = parser.value("shards").toInt();
+    if (defaults.shards < 1) { defaults.shards = QThread::idealThreadCount(); }
+    defaults.verifyShards = parser.isSet("verify-shards");
+    defaults.useCache = !parser.isSet("no-cache");
+    defaults.passThrough = !parser.isSet("no-pass-through");
+    defaults.useLibrary = !parser.isSet("no-libgs");
+    CyanPDFResources::setMaxRuns(qMax(1, parser.value("jobs").toInt()) * defaults.shards);
+    if (parser.isSet("memory-limit")) { CyanPDFResources::setMemoryLimit(parser.value("memory-limit").toLongLong() * 1024 * 1024); }
+    if (parser.isSet("cache-size")) { CyanPDFCache::setMaxSize(parser.value("cache-size").toLongLong() * 1024 * 1024); }
+
+    defaults.preset = CyanPDFCore::getPreset(parser.value("preset"));
+    if (defaults.preset < 0) {
+        err << tr("Invalid preset %1.").arg(parser.value("preset")) << Qt::endl;
+        return ExitUsage;
+    }
+
+    bool validIntent = false;
+    defaults.renderIntent = parser.value("intent").toInt(&validIntent);
+    if (!validIntent ||
+        defaults.renderIntent < CyanPDFCore::RenderIntent::Perceptual ||
+        defaults.renderIntent > CyanPDFCore::RenderIntent::AbsoluteColorimetric) {
+        err << tr("Invalid rendering intent %1.").arg(parser.value("intent")) << Qt::endl;
+        return ExitUsage;
+    }
+
+    // with --serve the output profile may come with each request instead
+    const int outCs = CyanPDFCore::getColorspace(defaults.outputIcc);
+    const bool outOptional = parser.isSet("serve") && defaults.outputIcc.isEmpty();
+    if (!outOptional && outCs != CyanPDFCore::ColorSpace::CMYK && outCs != CyanPDFCore::ColorSpace::GRAY) {
+        err << tr("Missing or invalid output (CMYK/GRAY) profile.") << Qt::endl;
+        return ExitUsage;
+    }
+    if (CyanPDFCore::getColorspace(defaults.defRgbIcc) != CyanPDFCore::ColorSpace::RGB ||
+        CyanPDFCore::getColorspace(defaults.defCmykIcc) != CyanPDFCore::ColorSpace::CMYK ||
+        CyanPDFCore::getColorspace(defaults.defGrayIcc) != CyanPDFCore::ColorSpace::GRAY) {
+        err << tr("Missing or invalid default RGB/CMYK/GRAY profile.") << Qt::endl;
+        return ExitUsage;
+    }
+    if (CyanPDFCore::getGhostscript().isEmpty() || CyanPDFCore::getGhostscriptVersion().isEmpty()) {
+        err << tr("Ghostscript not found, please install.") << Qt::endl;
+        return ExitUsage;
+    }
+
+    if (parser.isSet("serve")) {
+        QString error;
+        mServer = new CyanPDFServer(defaults, this);
+        mServer->setMaxJobs(parser.value("jobs").toInt());
+        if (!mServer->listen(parser.value("socket"), &error)) {
+            err << error << Qt::endl;
+            return ExitUsage;
+        }
+        return QCoreApplication::exec();
+    }
+
+    if (parser.isSet("watch")) {
+        const int jobs = parser.value("jobs").toInt();
+        const int pending = parser.isSet("queue-size") ? parser.value("queue-size").toInt() : 2 * qMax(1, jobs);
+        QString error;
+        mWatch = new CyanPDFWatch(defaults, this);
+        mWatch->setMaxJobs(jobs);
+        mWatch->setMaxPending(qMax(1, pending));
+        mWatch->setSettleTime(int(parser.value("settle").toDouble() * 1000));
+        if (!mWatch->start(parser.value("watch"),
+                           outputDir,
+                           parser.value("done"),
+                           parser.value("error"),
+                           &error)) {
+            err << error << Qt::endl;
+            return ExitUsage;
+        }
+        return QCoreApplication::exec();
+    }
+
+#ifdef Q_OS_WIN
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    QStringList inputs;
+    for (const QString &arg : parser.positionalArguments()) {
+        if (CyanPDFJob::isStream(arg)) {
+            const QString spool = mSpool ? mSpool->fileName() : spoolInput();
+            if (spool.isEmpty()) {
+                err << tr("Unable to read a PDF document from stdin.") << Qt::endl;
+                return ExitUsage;
+            }
+            inputs << spool;
+            continue;
+        }
+        QFileInfo info(arg);
+        if (info.isDir()) {
+            const auto files = QDir(arg).entryInfoList({"*.pdf", "*.PDF"}, QDir::Files | QDir::Readable, QDir::Name);
+            for (const QFileInfo &file : files) { inputs << file.absoluteFilePath(); }
+        } else {
+            inputs << info.absoluteFilePath();
+        }
+    }
+    inputs.removeDuplicates();
+    if (inputs.isEmpty()) {
+        err << tr("No input documents.") << Qt::endl;
+        return ExitUsage;
+    }
+    if (mStreaming && inputs.count() != 1) {
+        err << tr("Output to stdout needs exactly one input document.") << Qt::endl;
+        return ExitUsage;
+    }
+
+    mQueue = new CyanPDFQueue(this);
+    mQueue->setMaxJobs(parser.value("jobs").toInt());
+    mTotal = inputs.count();
+    mFailed = 0;
+    mVerify = !parser.isSet("no-verify") && !mStreaming;
+    mInkLimit = parser.isSet("ink-limit") ? parser.value("ink-limit").toInt() : 0;
+    if (parser.isSet("ink-limit") && (mInkLimit < 1 || mInkLimit > 400 || mStreaming)) {
+        err << tr("Invalid ink limit, or output to stdout.") << Qt::endl;
+        return ExitUsage;
+    }
+    // one thread is plenty, a check takes a fraction of the conversion it follows
+    mVerifyPool.setMaxThreadCount(1);
+
+    connect(mQueue, &CyanPDFQueue::jobFinished,
+            this, [this](CyanPDFJob *job, bool success, const QString &error) {
+        // stdout carries the document when streaming
+        QTextStream out(mStreaming ? stderr : stdout);
+        QTextStream err(stderr);
+        const auto &settings = job->settings();
+        const QString seconds = QString::number(job->elapsed() / 1000.0, 'f', 2);
+        if (!success) {
+            mFailed++;
+            err << QString("FAILED %1: %2 (%3s)").arg(settings.inputFile, error, seconds) << Qt::endl;
+            if (!job->log().trimmed().isEmpty()) { err << job->log().trimmed() << Qt::endl; }
+            return;
+        }
+        const QString result = QString("%1 -> %2 (%3s, %4%5)").arg(settings.inputFile,
+                                                                   settings.outputFile,
+                                                                   seconds,
+                                                                   mStreaming ? tr("streamed") : QLocale::c().formattedDataSize(QFileInfo(settings.outputFile).size()),
+                                                                   job->isCached() ? ", cached" :
+                                                                   job->isPassedThrough() ? ", passed through" : "");
+        const bool verify = mVerify && !job->isPassedThrough();
+        if (!verify && mInkLimit < 1) {
+            out << "OK " << result << Qt::endl;
+            return;
+        }
+
+        // checks run on their own thread while the queue starts the next document,
+        // the result is the list of problems and the ink summary
+        mVerifying++;
+        const auto watcher = new QFutureWatcher<QPair<QStringList, QString>>(this);
+        connect(watcher, &QFutureWatcher<QPair<QStringList, QString>>::finished,
+                this, [this, watcher, result]() {
+            const auto checked = watcher->result();
+            watcher->deleteLater();
+            mVerifying--;
+            if (checked.first.isEmpty()) {
+                QTextStream(stdout) << "OK " << result << checked.second << Qt::endl;
+            } else {
+                mFailed++;
+                QTextStream(stderr) << "INVALID " << result << checked.second << ": " << checked.first.join(" ") << Qt::endl;
+            }
+            finish();
+        });
+        watcher->setFuture(QtConcurrent::run(&mVerifyPool, [verify,
+                                                            limit = mInkLimit,
+                                                            output = settings.outputFile,
+                                                            icc = settings.outputIcc]() {
+            QPair<QStringList, QString> checked;
+            if (verify) { checked.first = CyanPDFPreflight::verify(output, icc); }
+            if (limit < 1) { return checked; }
+            const CyanPDFInk::Report ink = CyanPDFInk::getReport(output, limit);
+            if (!ink.valid) {
+                checked.first << QObject::tr("Unable to measure total ink.");
+                return checked;
+            }
+            checked.second = QString(" [ink %1% max on page %2, %3% average]").arg(qRound(ink.max))
+                                                                              .arg(ink.maxPage + 1)
+                                                                              .arg(qRound(ink.average));
+            if (!ink.pagesOver.isEmpty()) {
+                QStringList pages;
+                for (const int page : ink.pagesOver) { pages << QString::number(page + 1); }
+                checked.first << QObject::tr("Total ink above %1% on page(s) %2.").arg(limit).arg(pages.join(", "));
+            }
+            return checked;
+        }));
+    });
+    connect(mQueue, &CyanPDFQueue::idle,
+            this, [this]() {
+        mIdle = true;
+        finish();
+    });
+
+    // jobs run concurrently, inputs sharing a base name must not write the same file
+    QSet<QString> outputs;
+    for (const QString &input : inputs) {
+        CyanPDFJob::Settings settings = defaults;
+        settings.inputFile = input;
+        const QString name = mSpool && input == mSpool->fileName() ? QString("stdin") : QFileInfo(input).completeBaseName();
+        settings.outputFile = mStreaming ? outputDir : QDir(outputDir).absoluteFilePath(name + ".pdf");
+        for (int i = 2; !mStreaming && outputs.contains(settings.outputFile); ++i) {
+            settings.outputFile = QDir(outputDir).absoluteFilePath(QString("%1-%2.pdf").arg(name).arg(i));
+        }
+        outputs.insert(settings.outputFile);
+        mQueue->enqueue(settings);
+    }
+
+    return QCoreApplication::exec();
+}
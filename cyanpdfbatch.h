@@ -0,0 +1,56 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFBATCH_H
+#define CYANPDFBATCH_H
+
+#include <QObject>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <QThreadPool>
+
+#include <memory>
+
+#include "cyanpdfqueue.h"
+#include "cyanpdfwatch.h"
+#include "cyanpdfserver.h"
+
+class CyanPDFBatch : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum ExitCode {
+        ExitSuccess = 0,
+        ExitFailed = 1,
+        ExitUsage = 2
+    };
+
+    explicit CyanPDFBatch(QObject *parent = nullptr);
+
+    static bool isBatch(int argc, char *argv[]);
+    static const QString getDefaultProfile(const int &colorspace);
+
+    int exec(const QStringList &arguments);
+
+private:
+    const QString spoolInput();
+    void finish();
+
+    CyanPDFQueue *mQueue;
+    CyanPDFWatch *mWatch;
+    CyanPDFServer *mServer;
+    std::unique_ptr<QTemporaryFile> mSpool;
+    QThreadPool mVerifyPool;
+    bool mStreaming;
+    bool mVerify;
+    bool mIdle;
+    int mVerifying;
+    int mInkLimit;
+    int mTotal;
+    int mFailed;
+};
+
+#endif // CYANPDFBATCH_H
@@ -0,0 +1,436 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfcore.h"
+#include "cyanpdfjob.h"
+#include "cyanpdfghostscript.h"
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QPdfWriter>
+#include <QPdfDocument>
+#include <QPainter>
+#include <QPainterPath>
+#include <QLinearGradient>
+#include <QRandomGenerator>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QSysInfo>
+#include <QThread>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include <memory>
+
+#define CYANPDF_BENCH_FORMAT 1
+#define CYANPDF_BENCH_ARGS_REPEAT 100
+#define CYANPDF_BENCH_RENDER_PAGES 10
+#define CYANPDF_BENCH_RENDER_SIZE 1024
+
+enum CorpusKind {
+    Vector,
+    Image,
+    Transparency
+};
+
+struct CorpusEntry
+{
+    CorpusKind kind;
+    int pages;
+};
+
+static const QString getKindName(const CorpusKind &kind)
+{
+    switch (kind) {
+    case CorpusKind::Vector:
+        return "vector";
+    case CorpusKind::Image:
+        return "image";
+    case CorpusKind::Transparency:
+        return "transparency";
+    }
+    return QString();
+}
+
+static const QList<CorpusEntry> getCorpus(const int &maxPages)
+{
+    const QList<CorpusEntry> all = {
+        {CorpusKind::Vector, 1},
+        {CorpusKind::Vector, 10},
+        {CorpusKind::Vector, 100},
+        {CorpusKind::Vector, 1000},
+        {CorpusKind::Image, 1},
+        {CorpusKind::Image, 10},
+        {CorpusKind::Image, 100},
+        {CorpusKind::Transparency, 1},
+        {CorpusKind::Transparency, 10},
+        {CorpusKind::Transparency, 100}
+    };
+    QList<CorpusEntry> corpus;
+    for (const auto &entry : all) {
+        if (entry.pages <= maxPages) { corpus << entry; }
+    }
+    return corpus;
+}
+
+// draws are sequenced explicitly, argument evaluation order differs between compilers
+static const QColor getRandomColor(QRandomGenerator &rng,
+                                   const int &alpha = 255)
+{
+    const int r = rng.bounded(256);
+    const int g = rng.bounded(256);
+    const int b = rng.bounded(256);
+    return QColor(r, g, b, alpha);
+}
+
+static const QPoint getRandomPoint(QRandomGenerator &rng,
+                                   const QRect &rect)
+{
+    const int x = rng.bounded(rect.width());
+    const int y = rng.bounded(rect.height());
+    return QPoint(x, y);
+}
+
+static const QRect getRandomRect(QRandomGenerator &rng,
+                                 const QRect &rect,
+                                 const int &min,
+                                 const int &range)
+{
+    const QPoint pos = getRandomPoint(rng, rect);
+    const int width = min + rng.bounded(range);
+    const int height = min + rng.bounded(range);
+    return QRect(pos, QSize(width, height));
+}
+
+static const QImage getRandomImage(QRandomGenerator &rng,
+                                   const QSize &size,
+                                   const bool &alpha)
+{
+    // smooth gradients with some noise, compresses like a photo would
+    QImage image(size, alpha ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    const int r = rng.bounded(256);
+    const int g = rng.bounded(256);
+    const int b = rng.bounded(256);
+    for (int y = 0; y < size.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < size.width(); ++x) {
+            const int noise = rng.bounded(24);
+            line[x] = qRgba((r + x / 4 + noise) & 0xff,
+                            (g + y / 4 + noise) & 0xff,
+                            (b + (x + y) / 8 + noise) & 0xff,
+                            alpha ? (x * 255) / size.width() : 255);
+        }
+    }
+    return image;
+}
+
+static void drawVector(QPainter &painter,
+                       QRandomGenerator &rng,
+                       const QRect &rect)
+{
+    for (int i = 0; i < 60; ++i) {
+        QPainterPath path;
+        path.moveTo(getRandomPoint(rng, rect));
+        for (int c = 0; c < 4; ++c) {
+            const QPoint c1 = getRandomPoint(rng, rect);
+            const QPoint c2 = getRandomPoint(rng, rect);
+            path.cubicTo(c1, c2, getRandomPoint(rng, rect));
+        }
+        const QColor color = getRandomColor(rng);
+        painter.setPen(QPen(color, 2 + rng.bounded(12)));
+        painter.setBrush(Qt::NoBrush);
+        painter.drawPath(path);
+    }
+    for (int i = 0; i < 20; ++i) {
+        const QRect box = getRandomRect(rng, rect, 100, 600);
+        QLinearGradient gradient(box.topLeft(), box.bottomRight());
+        gradient.setColorAt(0, getRandomColor(rng));
+        gradient.setColorAt(1, getRandomColor(rng));
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(gradient);
+        painter.drawRect(box);
+    }
+    painter.setPen(Qt::black);
+    painter.setFont(QFont("Sans", 10));
+    for (int i = 0; i < 40; ++i) {
+        painter.drawText(QPoint(100, 200 + i * 80),
+                         QString("Cyan PDF benchmark line %1, %2").arg(i).arg(rng.generate()));
+    }
+}
+
+static void drawImages(QPainter &painter,
+                       QRandomGenerator &rng,
+                       const QRect &rect,
+                       const bool &alpha)
+{
+    const QSize size(1200, 900);
+    for (int i = 0; i < 4; ++i) {
+        const QRect target((i % 2) * rect.width() / 2,
+                           (i / 2) * rect.height() / 2,
+                           rect.width() / 2,
+                           rect.height() / 2);
+        painter.drawImage(target, getRandomImage(rng, size, alpha));
+    }
+}
+
+static void drawTransparency(QPainter &painter,
+                             QRandomGenerator &rng,
+                             const QRect &rect)
+{
+    drawImages(painter, rng, rect, true);
+    for (int i = 0; i < 30; ++i) {
+        painter.setOpacity(0.2 + rng.bounded(60) / 100.0);
+        painter.setPen(Qt::NoPen);
+        const int alpha = 64 + rng.bounded(128);
+        painter.setBrush(getRandomColor(rng, alpha));
+        painter.drawEllipse(getRandomRect(rng, rect, 200, 800));
+    }
+    painter.setOpacity(1.0);
+    drawVector(painter, rng, rect);
+}
+
+static const bool writeCorpus(const QString &filename,
+                              const CorpusEntry &entry)
+{
+    QPdfWriter writer(filename);
+    writer.setPageSize(QPageSize(QPageSize::A4));
+    writer.setResolution(300);
+    writer.setCreator("cyanpdf_bench");
+    writer.setTitle(QFileInfo(filename).completeBaseName());
+
+    // fixed seeds keep the corpus identical between runs and machines
+    QRandomGenerator rng(quint32(entry.kind * 100003 + entry.pages));
+    QPainter painter;
+    if (!painter.begin(&writer)) { return false; }
+    const QRect rect(QPoint(0, 0), writer.pageLayout().paintRectPixels(writer.resolution()).size());
+    for (int page = 0; page < entry.pages; ++page) {
+        if (page > 0) { writer.newPage(); }
+        switch (entry.kind) {
+        case CorpusKind::Vector:
+            drawVector(painter, rng, rect);
+            break;
+        case CorpusKind::Image:
+            drawImages(painter, rng, rect, false);
+            break;
+        case CorpusKind::Transparency:
+            drawTransparency(painter, rng, rect);
+            break;
+        }
+    }
+    return painter.end();
+}
+
+static const QString findGhostscriptProfiles(const QString &custom)
+{
+    QStringList folders;
+    if (!custom.isEmpty()) { folders << custom; }
+    const QString gsPath = CyanPDFCore::getGhostscript(true);
+    const QString gsVer = CyanPDFCore::getGhostscriptVersion();
+    folders << QString("%1/../share/ghostscript/%2/iccprofiles").arg(gsPath, gsVer);
+    folders << QString("%1/../iccprofiles").arg(gsPath);
+    folders << "/usr/share/color/icc/ghostscript";
+    for (const QString &folder : std::as_const(folders)) {
+        if (QFile::exists(QString("%1/default_cmyk.icc").arg(folder))) {
+            return QDir(folder).absolutePath();
+        }
+    }
+    return QString();
+}
+
+static const double getMs(const qint64 &nsecs)
+{
+    return double(nsecs) / 1000000.0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) { qputenv("QT_QPA_PLATFORM", "offscreen"); }
+
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("cyanpdf");
+    QCoreApplication::setOrganizationName("cyanpdf");
+    QCoreApplication::setApplicationVersion(QString(CYANPDF_VERSION));
+    QCoreApplication::setOrganizationDomain(QString(CYANPDF_ID));
+
+    QTextStream err(stderr);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Cyan PDF benchmark");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"corpus", "Folder for the generated documents, reused between runs.", "folder"},
+        {"icc-dir", "Folder containing the Ghostscript default_*.icc profiles.", "folder"},
+        {"max-pages", "Skip documents with more pages (1-1000).", "pages", "1000"},
+        {"repeat", "Number of conversions per document.", "count", "1"},
+        {"no-libgs", "Always run the Ghostscript executable instead of libgs."},
+        {{"o", "output"}, "Write the JSON results to this file instead of stdout.", "file"}
+    });
+    parser.process(app);
+
+    const QString iccDir = findGhostscriptProfiles(parser.value("icc-dir"));
+    if (iccDir.isEmpty()) {
+        err << "Ghostscript ICC profiles not found, use --icc-dir." << Qt::endl;
+        return 2;
+    }
+
+    std::unique_ptr<QTemporaryDir> tempDir;
+    QString corpusDir = parser.value("corpus");
+    if (corpusDir.isEmpty()) {
+        tempDir = std::make_unique<QTemporaryDir>();
+        corpusDir = tempDir->path();
+    }
+    const QString outputDir = QString("%1/output").arg(corpusDir);
+    if (!QDir().mkpath(outputDir)) {
+        err << "Unable to create " << outputDir << Qt::endl;
+        return 2;
+    }
+
+    CyanPDFJob::Settings defaults;
+    defaults.outputIcc = QString("%1/default_cmyk.icc").arg(iccDir);
+    defaults.defRgbIcc = QString("%1/default_rgb.icc").arg(iccDir);
+    defaults.defCmykIcc = QString("%1/default_cmyk.icc").arg(iccDir);
+    defaults.defGrayIcc = QString("%1/default_gray.icc").arg(iccDir);
+    defaults.useCache = false;
+    defaults.passThrough = false;
+    defaults.useLibrary = !parser.isSet("no-libgs");
+
+    QJsonObject result;
+    result["format"] = CYANPDF_BENCH_FORMAT;
+    result["version"] = QString(CYANPDF_VERSION);
+    result["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    result["system"] = QSysInfo::prettyProductName();
+    result["cpu"] = QSysInfo::currentCpuArchitecture();
+    result["threads"] = QThread::idealThreadCount();
+    result["ghostscript"] = CyanPDFCore::getGhostscriptVersion();
+    result["engine"] = defaults.useLibrary && CyanPDFGhostscript::isAvailable() ? "libgs" : "process";
+    result["profiles"] = iccDir;
+
+    QElapsedTimer timer;
+    timer.start();
+    int profiles = 0;
+    for (const int colorspace : {CyanPDFCore::ColorSpace::RGB, CyanPDFCore::ColorSpace::CMYK, CyanPDFCore::ColorSpace::GRAY}) {
+        profiles += CyanPDFCore::getProfiles(colorspace).count();
+    }
+    const qint64 scanCold = timer.nsecsElapsed();
+    timer.restart();
+    for (const int colorspace : {CyanPDFCore::ColorSpace::RGB, CyanPDFCore::ColorSpace::CMYK, CyanPDFCore::ColorSpace::GRAY}) {
+        CyanPDFCore::getProfiles(colorspace);
+    }
+    result["scan"] = QJsonObject {
+        {"profiles", profiles},
+        {"cold_ms", getMs(scanCold)},
+        {"warm_ms", getMs(timer.nsecsElapsed())}
+    };
+
+    const int maxPages = qBound(1, parser.value("max-pages").toInt(), 1000);
+    const int repeat = qMax(1, parser.value("repeat").toInt());
+    bool failed = false;
+    QJsonArray documents;
+    for (const auto &entry : getCorpus(maxPages)) {
+        const QString name = QString("%1-%2").arg(getKindName(entry.kind)).arg(entry.pages, 4, 10, QChar('0'));
+        const QString inputFile = QString("%1/%2.pdf").arg(corpusDir, name);
+        const QString outputFile = QString("%1/%2.pdf").arg(outputDir, name);
+        err << "Benchmarking " << name << Qt::endl;
+
+        QJsonObject document;
+        document["name"] = name;
+        document["kind"] = getKindName(entry.kind);
+        document["pages"] = entry.pages;
+
+        timer.restart();
+        if (!QFile::exists(inputFile) && !writeCorpus(inputFile, entry)) {
+            err << "Unable to write " << inputFile << Qt::endl;
+            return 2;
+        }
+        document["generate_ms"] = getMs(timer.nsecsElapsed());
+        document["bytes"] = QFileInfo(inputFile).size();
+
+        timer.restart();
+        const QString checksum = CyanPDFCore::getChecksum(inputFile);
+        document["checksum_ms"] = getMs(timer.nsecsElapsed());
+        document["checksum"] = checksum;
+
+        const int outCs = CyanPDFCore::getColorspace(defaults.outputIcc);
+        timer.restart();
+        const QStringList args = CyanPDFCore::getConvertArgs(inputFile, outputFile,
+                                                             defaults.outputIcc, defaults.defRgbIcc,
+                                                             defaults.defGrayIcc, defaults.defCmykIcc,
+                                                             outCs);
+        document["args_first_ms"] = getMs(timer.nsecsElapsed());
+        timer.restart();
+        for (int i = 0; i < CYANPDF_BENCH_ARGS_REPEAT; ++i) {
+            CyanPDFCore::getConvertArgs(inputFile, outputFile,
+                                        defaults.outputIcc, defaults.defRgbIcc,
+                                        defaults.defGrayIcc, defaults.defCmykIcc,
+                                        outCs);
+        }
+        document["args_ms"] = getMs(timer.nsecsElapsed() / CYANPDF_BENCH_ARGS_REPEAT);
+        if (args.isEmpty()) {
+            document["error"] = "Unable to generate Ghostscript arguments.";
+            documents << document;
+            failed = true;
+            continue;
+        }
+
+        CyanPDFJob::Settings settings = defaults;
+        settings.inputFile = inputFile;
+        settings.outputFile = outputFile;
+        QJsonArray convert;
+        QString error;
+        bool converted = true;
+        for (int i = 0; i < repeat && converted; ++i) {
+            timer.restart();
+            converted = CyanPDFJob::convert(settings, &error);
+            convert << getMs(timer.nsecsElapsed());
+        }
+        document["convert_ms"] = convert;
+        if (!converted) {
+            document["error"] = error;
+            documents << document;
+            failed = true;
+            continue;
+        }
+        document["output_bytes"] = QFileInfo(outputFile).size();
+
+        QPdfDocument pdf;
+        timer.restart();
+        if (pdf.load(outputFile) != QPdfDocument::Error::None) {
+            document["error"] = "Unable to load the converted document.";
+            documents << document;
+            failed = true;
+            continue;
+        }
+        document["load_ms"] = getMs(timer.nsecsElapsed());
+        const int renderPages = qMin(pdf.pageCount(), CYANPDF_BENCH_RENDER_PAGES);
+        timer.restart();
+        for (int page = 0; page < renderPages; ++page) {
+            const QSize size = pdf.pagePointSize(page).scaled(CYANPDF_BENCH_RENDER_SIZE,
+                                                              CYANPDF_BENCH_RENDER_SIZE,
+                                                              Qt::KeepAspectRatio).toSize();
+            pdf.render(page, size);
+        }
+        document["render_pages"] = renderPages;
+        document["render_ms"] = renderPages > 0 ? getMs(timer.nsecsElapsed() / renderPages) : 0.0;
+        documents << document;
+    }
+    result["documents"] = documents;
+
+    const QByteArray json = QJsonDocument(result).toJson();
+    if (parser.isSet("output")) {
+        QFile file(parser.value("output"));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size()) {
+            err << "Unable to write " << parser.value("output") << Qt::endl;
+            return 2;
+        }
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return failed ? 1 : 0;
+}
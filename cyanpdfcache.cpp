@@ -0,0 +1,147 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfcache.h"
+#include "cyanpdfdigest.h"
+#include "cyanpdftransforms.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QSettings>
+
+#include <algorithm>
+
+#define CYANPDF_CACHE_FORMAT 2
+#define CYANPDF_CACHE_DEFAULT_SIZE 2048
+#define CYANPDF_CACHE_STALE_HOURS 12
+
+static qint64 cacheMaxSize = 0;
+
+const QString CyanPDFCache::getResultsPath()
+{
+    const QString cache = CyanPDFCore::getCachePath();
+    if (cache.isEmpty()) { return QString(); }
+    const QString path = cache + "/results";
+    if (!QFile::exists(path)) {
+        QDir dir(path);
+        if (!dir.mkpath(path)) { return QString(); }
+    }
+    return path;
+}
+
+const QString CyanPDFCache::getKey(const CyanPDFJob::Settings &settings)
+{
+    const QStringList parts = {
+        QString::number(CYANPDF_CACHE_FORMAT),
+        CyanPDFDigest::getDigest(settings.inputFile),
+        CyanPDFDigest::getDigest(settings.outputIcc),
+        CyanPDFDigest::getDigest(settings.defRgbIcc),
+        CyanPDFDigest::getDigest(settings.defGrayIcc),
+        CyanPDFDigest::getDigest(settings.defCmykIcc),
+        QString::number(settings.renderIntent),
+        settings.blackPoint ? "bpc" : "nobpc",
+        settings.overrideIcc ? "override" : "nooverride",
+        CyanPDFCore::getPresetName(settings.preset),
+        CyanPDFCore::getGhostscriptVersion()
+    };
+    for (int i = 1; i < parts.count(); ++i) {
+        if (parts.at(i).isEmpty()) { return QString(); }
+    }
+    return QCryptographicHash::hash(parts.join('\n').toUtf8(),
+                                    QCryptographicHash::Sha256).toHex();
+}
+
+const QString CyanPDFCache::lookup(const QString &key)
+{
+    if (key.isEmpty()) { return QString(); }
+    const QString path = QString("%1/%2.pdf").arg(getResultsPath(), key);
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) { return QString(); }
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    file.close();
+    return path;
+}
+
+const bool CyanPDFCache::store(const QString &key,
+                               const QString &filename)
+{
+    const QString results = getResultsPath();
+    if (key.isEmpty() || results.isEmpty() || !CyanPDFCore::isPDF(filename)) { return false; }
+
+    // QSaveFile writes to a unique temporary file, so jobs storing the same key do not collide
+    QFile input(filename);
+    QSaveFile output(QString("%1/%2.pdf").arg(results, key));
+    if (!input.open(QIODevice::ReadOnly) || !output.open(QIODevice::WriteOnly)) { return false; }
+    while (!input.atEnd()) {
+        const QByteArray data = input.read(1024 * 1024);
+        if (data.isEmpty() || output.write(data) != data.size()) {
+            output.cancelWriting();
+            return false;
+        }
+    }
+    if (!output.commit()) { return false; }
+    evict();
+    return true;
+}
+
+void CyanPDFCache::setMaxSize(const qint64 &bytes)
+{
+    cacheMaxSize = bytes;
+}
+
+const qint64 CyanPDFCache::getMaxSize()
+{
+    if (cacheMaxSize > 0) { return cacheMaxSize; }
+    QSettings settings;
+    settings.beginGroup("cyanpdf");
+    const qint64 size = settings.value("cacheSize", CYANPDF_CACHE_DEFAULT_SIZE).toLongLong();
+    settings.endGroup();
+    return size * 1024 * 1024;
+}
+
+void CyanPDFCache::evict()
+{
+    const QString cache = CyanPDFCore::getCachePath();
+    const QString results = getResultsPath();
+    const QString links = CyanPDFTransforms::getLinksPath();
+    if (cache.isEmpty() || results.isEmpty() || links.isEmpty()) { return; }
+
+    // shard folders, stdin spools and half written files of runs that crashed or were killed
+    const QDateTime stale = QDateTime::currentDateTime().addSecs(-CYANPDF_CACHE_STALE_HOURS * 3600);
+    QFileInfoList leftovers = QDir(cache).entryInfoList({"job-*", "stdin-*.spool"}, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+    for (const QFileInfo &info : QDir(results).entryInfoList(QDir::Files)) {
+        if (info.suffix() != "pdf") { leftovers << info; }
+    }
+    for (const QFileInfo &info : QDir(links).entryInfoList(QDir::Files)) {
+        if (info.suffix() != "icc") { leftovers << info; }
+    }
+    for (const QFileInfo &info : std::as_const(leftovers)) {
+        if (info.lastModified() > stale) { continue; }
+        if (info.isDir()) { QDir(info.absoluteFilePath()).removeRecursively(); }
+        else { QFile::remove(info.absoluteFilePath()); }
+    }
+
+    // results, device links and PDF/X definitions share the budget, all are touched when used
+    QFileInfoList files = QDir(results).entryInfoList({"*.pdf"}, QDir::Files);
+    files << QDir(links).entryInfoList({"*.icc"}, QDir::Files);
+    files << QDir(cache).entryInfoList({"pdfx-*.ps"}, QDir::Files);
+    qint64 total = 0;
+    for (const QFileInfo &info : std::as_const(files)) { total += info.size(); }
+
+    const qint64 budget = getMaxSize();
+    if (total <= budget) { return; }
+
+    std::sort(files.begin(), files.end(), [](const QFileInfo &a, const QFileInfo &b) {
+        return a.lastModified() < b.lastModified();
+    });
+    for (const QFileInfo &info : files) {
+        if (total <= budget) { break; }
+        if (QFile::remove(info.absoluteFilePath())) { total -= info.size(); }
+    }
+}
@@ -0,0 +1,28 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFCACHE_H
+#define CYANPDFCACHE_H
+
+#include <QString>
+
+#include "cyanpdfjob.h"
+
+class CyanPDFCache
+{
+public:
+    static const QString getResultsPath();
+    static const QString getKey(const CyanPDFJob::Settings &settings);
+
+    static const QString lookup(const QString &key);
+    static const bool store(const QString &key,
+                            const QString &filename);
+
+    static void setMaxSize(const qint64 &bytes);
+    static const qint64 getMaxSize();
+    static void evict();
+};
+
+#endif // CYANPDFCACHE_H
@@ -0,0 +1,401 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfcore.h"
+#include "cyanpdfprofiles.h"
+#include "cyanpdfdigest.h"
+#include "cyanpdffiletype.h"
+#include "cyanpdfghostscript.h"
+#include "cyanpdftrace.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QSettings>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QHash>
+
+#include <utility>
+
+static QMutex toolchainMutex;
+static QString toolchainGhostscript;
+static QString toolchainVersionPath;
+static QString toolchainVersion;
+static qint64 toolchainModified = -1;
+static QHash<QString, QString> toolchainTemplates;
+
+const QString CyanPDFCore::getGhostscript(bool pathOnly)
+{
+    CyanPDFTrace::Span span("getGhostscript");
+    QString gs;
+    {
+        QMutexLocker lock(&toolchainMutex);
+        gs = toolchainGhostscript;
+    }
+    if (gs.isEmpty() || !QFile::exists(gs)) {
+        gs = findGhostscript();
+        QMutexLocker lock(&toolchainMutex);
+        toolchainGhostscript = gs;
+    }
+    if (gs.isEmpty()) { return QString(); }
+
+    QFileInfo info(gs);
+#ifdef Q_OS_WIN
+    return pathOnly ? QFileInfo(info.absolutePath()).absolutePath() : info.absoluteFilePath();
+#else
+    return pathOnly ? info.absolutePath() : info.absoluteFilePath();
+#endif
+}
+
+const QString CyanPDFCore::findGhostscript()
+{
+#ifdef Q_OS_WIN
+    QString appDir = QString("%1/gs").arg(QCoreApplication::applicationDirPath());
+    if (QFile::exists(appDir)) {
+        QString bin64 = appDir + "/bin/gswin64c.exe";
+        if (QFile::exists(bin64)) { return bin64; }
+        QString bin32 = appDir + "/bin/gswin32c.exe";
+        if (QFile::exists(bin32)) { return bin32; }
+    }
+    QString programFilesPath(qgetenv("PROGRAMFILES"));
+    QDirIterator it(programFilesPath + "/gs", {"*.*"}, QDir::Dirs);
+    while (it.hasNext()) {
+        QString folder = it.next();
+        QString bin64 = folder + "/bin/gswin64c.exe";
+        if (QFile::exists(bin64)) { return bin64; }
+        QString bin32 = folder + "/bin/gswin32c.exe";
+        if (QFile::exists(bin32)) { return bin32; }
+    }
+#endif
+    QString gs = QStandardPaths::findExecutable("gs");
+    if (gs.isEmpty()) {
+        gs = QStandardPaths::findExecutable("gs", {"/opt/local/bin",
+                                                   "/usr/local/bin"});
+    }
+    if (gs.isEmpty()) { return QString(); }
+    return QFileInfo(gs).absoluteFilePath();
+}
+
+const QString CyanPDFCore::getGhostscriptVersion()
+{
+    CyanPDFTrace::Span span("getGhostscriptVersion");
+    const QString gs = getGhostscript();
+    if (!QFile::exists(gs)) { return QString(); }
+    const qint64 modified = QFileInfo(gs).lastModified().toMSecsSinceEpoch();
+    {
+        QMutexLocker lock(&toolchainMutex);
+        if (toolchainVersionPath == gs && toolchainModified == modified) { return toolchainVersion; }
+    }
+
+    QString version;
+    QSettings settings;
+    settings.beginGroup("toolchain");
+    if (settings.value("ghostscript").toString() == gs &&
+        settings.value("modified").toLongLong() == modified) {
+        version = settings.value("version").toString();
+    }
+    if (version.isEmpty()) { version = CyanPDFGhostscript::getRevision(); }
+    if (version.isEmpty()) {
+        QProcess proc;
+        proc.start(gs, {"--version"});
+        if (proc.waitForStarted()) {
+            proc.waitForFinished();
+            QByteArray result = proc.readAll();
+            if (proc.exitCode() == 0) { version = result.trimmed(); }
+        }
+        if (!version.isEmpty()) {
+            settings.setValue("ghostscript", gs);
+            settings.setValue("modified", modified);
+            settings.setValue("version", version);
+        }
+    }
+    settings.endGroup();
+    if (version.isEmpty()) { return QString(); }
+
+    QMutexLocker lock(&toolchainMutex);
+    toolchainVersionPath = gs;
+    toolchainModified = modified;
+    toolchainVersion = version;
+    return version;
+}
+
+const QString CyanPDFCore::getPostscript(const QString &profile)
+{
+    CyanPDFTrace::Span span("getPostscript", profile);
+    if (!isICC(profile)) { return QString(); }
+
+    const QString gsPath = getGhostscript(true);
+    if (!QFile::exists(gsPath)) { return QString(); }
+
+    const QString gsVer = getGhostscriptVersion();
+    if (gsVer.isEmpty()) { return QString(); }
+
+    const QString ps = QString("%1/../share/ghostscript/%2/lib/PDFX_def.ps").arg(gsPath, gsVer);
+    const QFileInfo info(profile);
+    const QStringList keys = {
+        gsVer,
+        QFileInfo(ps).absoluteFilePath(),
+        info.absoluteFilePath(),
+        QString::number(info.lastModified().toMSecsSinceEpoch()),
+        QString::number(info.size())
+    };
+    const QString output = QString("%1/pdfx-%2.ps").arg(getCachePath(),
+                                                        QCryptographicHash::hash(keys.join('\n').toUtf8(),
+                                                                                 QCryptographicHash::Sha1).toHex());
+    {
+        QFile file(output);
+        if (file.open(QIODevice::ReadOnly)) {
+            file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+            file.close();
+            return output;
+        }
+    }
+
+    QString content;
+    {
+        QMutexLocker lock(&toolchainMutex);
+        content = toolchainTemplates.value(ps);
+    }
+    if (content.isEmpty()) {
+        QFile file(ps);
+        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            content = file.readAll();
+            file.close();
+        }
+        if (content.isEmpty()) { return QString(); }
+        QMutexLocker lock(&toolchainMutex);
+        toolchainTemplates.insert(ps, content);
+    }
+
+    static QRegularExpression regex("/ICCProfile \\([^)]*\\) def");
+    QString escaped = info.absoluteFilePath();
+    escaped.replace("\\", "\\\\").replace("(", "\\(").replace(")", "\\)");
+    const QString replacement = QString("/ICCProfile (%1) def").arg(escaped);
+    QRegularExpressionMatchIterator it = regex.globalMatch(content);
+    QList<QRegularExpressionMatch> matches;
+    while (it.hasNext()) { matches.prepend(it.next()); }
+    for (const auto &match : std::as_const(matches)) {
+        content.replace(match.capturedStart(), match.capturedLength(), replacement);
+    }
+
+    QSaveFile newFile(output);
+    if (newFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        newFile.write(content.toUtf8());
+        if (newFile.commit()) { return output; }
+    }
+    return QString();
+}
+
+const QString CyanPDFCore::getCachePath()
+{
+    QStringList paths = QStandardPaths::standardLocations(QStandardPaths::GenericCacheLocation);
+    QString path = paths.first();
+    if (path.isEmpty()) { path = QDir::tempPath(); }
+    path.append("/cyanpdf");
+    if (!QFile::exists(path)) {
+        QDir dir(path);
+        if (!dir.mkpath(path)) { return QString(); }
+    }
+    return path;
+}
+
+const QString CyanPDFCore::getChecksum(const QString &filename)
+{
+    CyanPDFTrace::Span span("getChecksum", filename);
+    if (!isPDF(filename)) { return QString(); }
+    return CyanPDFDigest::getDigest(filename, CyanPDFDigest::Algorithm::Sha256);
+}
+
+const QStringList CyanPDFCore::getConvertArgs(const QString &inputFile,
+                                              const QString &outputFile,
+                                              const QString &outputIcc,
+                                              const QString defRgbIcc,
+                                              const QString defGrayIcc,
+                                              const QString defCmykIcc,
+                                              const int &colorSpace,
+                                              const int &renderIntent,
+                                              const bool &blackPoint,
+                                              const bool &overrideIcc,
+                                              const int &preset)
+{
+    CyanPDFTrace::Span span("getConvertArgs", inputFile);
+    QStringList args;
+    const QString cs = colorSpace == ColorSpace::CMYK ? "CMYK" : "GRAY";
+    const QString ps = getPostscript(outputIcc);
+
+    const QStringList presetArgs = getPresetArgs(preset);
+    if (presetArgs.isEmpty() ||
+        !QFile::exists(ps) ||
+        !isICC(defRgbIcc) ||
+        !isICC(defGrayIcc) ||
+        !isICC(defCmykIcc) ||
+        !isICC(outputIcc) ||
+        !isPDF(inputFile)) { return args; }
+
+    if (getColorspace(defRgbIcc) != ColorSpace::RGB ||
+        getColorspace(defGrayIcc) != ColorSpace::GRAY ||
+        getColorspace(defCmykIcc) != ColorSpace::CMYK ||
+        getColorspace(outputIcc) != colorSpace) { return args; }
+
+    args << "-dPDFX" << "-dBATCH" << "-dNOPAUSE" << "-dNOSAFER" << "-sDEVICE=pdfwrite"
+         << "-dEncodeColorImages=true" << "-dEmbedAllFonts=true"
+         << QString("-dOverrideICC=%1").arg(overrideIcc ? "true" : "false")
+         << QString("-sProcessColorModel=Device%1").arg(cs)
+         << QString("-sColorConversionStrategy=%1").arg(cs)
+         << QString("-sColorConversionStrategyForImages=%1").arg(cs)
+         << QString("-dRenderIntent=%1").arg(QString::number(renderIntent))
+         << QString("-dPreserveBlack=%1").arg(blackPoint ? "true" : "false")
+         << QString("-sDefaultRGBProfile=%1").arg(defRgbIcc)
+         << QString("-sDefaultGrayProfile=%1").arg(defGrayIcc)
+         << QString("-sDefaultCMYKProfile=%1").arg(defCmykIcc)
+         << QString("-sOutputICCProfile=%1").arg(outputIcc)
+         << presetArgs
+         << QString("-sOutputFile=%1").arg(outputFile)
+         << QString("%1").arg(ps)
+         << QString("%1").arg(inputFile);
+    return args;
+}
+
+const QStringList CyanPDFCore::getMergeArgs(const QStringList &inputFiles,
+                                            const QString &outputFile,
+                                            const QString &outputIcc)
+{
+    CyanPDFTrace::Span span("getMergeArgs", outputFile);
+    QStringList args;
+    const int colorSpace = getColorspace(outputIcc);
+    const QString ps = getPostscript(outputIcc);
+    if (inputFiles.isEmpty() ||
+        !QFile::exists(ps) ||
+        !isICC(outputIcc) ||
+        (colorSpace != ColorSpace::CMYK && colorSpace != ColorSpace::GRAY)) { return args; }
+
+    // the inputs are already converted, PDF/X only needs the strategy to match the output space
+    const QString cs = colorSpace == ColorSpace::CMYK ? "CMYK" : "GRAY";
+    args << "-dPDFX" << "-dBATCH" << "-dNOPAUSE" << "-dNOSAFER" << "-sDEVICE=pdfwrite"
+         << "-dEmbedAllFonts=true" << "-dSubsetFonts=true" << "-dCompressFonts=true"
+         << "-dDetectDuplicateImages=true"
+         << "-dPassThroughJPEGImages=true" << "-dPassThroughJPXImages=true"
+         << QString("-sProcessColorModel=Device%1").arg(cs)
+         << QString("-sColorConversionStrategy=%1").arg(cs)
+         << QString("-sOutputICCProfile=%1").arg(outputIcc);
+    for (const QString type : {"Color", "Gray", "Mono"}) {
+        args << QString("-dDownsample%1Images=false").arg(type);
+    }
+    for (const QString type : {"Color", "Gray"}) {
+        args << QString("-dAutoFilter%1Images=false").arg(type)
+             << QString("-s%1ImageFilter=FlateEncode").arg(type);
+    }
+    args << QString("-sOutputFile=%1").arg(outputFile)
+         << ps
+         << inputFiles;
+    return args;
+}
+
+const QStringList CyanPDFCore::getPresetArgs(const int &preset)
+{
+    QString colorFilter;
+    int colorResolution = 0;
+    int monoResolution = 0;
+    switch (preset) {
+    case Preset::Press:
+        break;
+    case Preset::Digital:
+        colorResolution = 300;
+        monoResolution = 1200;
+        break;
+    case Preset::Proof:
+        colorResolution = 150;
+        monoResolution = 600;
+        colorFilter = "DCTEncode";
+        break;
+    default:
+        return QStringList();
+    }
+
+    QStringList args;
+    for (const QString type : {"Color", "Gray", "Mono"}) {
+        const int resolution = type == "Mono" ? monoResolution : colorResolution;
+        args << QString("-dDownsample%1Images=%2").arg(type, resolution > 0 ? "true" : "false");
+        if (resolution < 1) { continue; }
+        args << QString("-d%1ImageResolution=%2").arg(type).arg(resolution)
+             << QString("-d%1ImageDownsampleThreshold=1.5").arg(type)
+             << QString("-d%1ImageDownsampleType=/%2").arg(type, type == "Mono" ? "Subsample" : "Bicubic");
+    }
+    for (const QString type : {"Color", "Gray"}) {
+        // without a fixed filter pdfwrite picks JPEG or Flate per image
+        args << QString("-dAutoFilter%1Images=%2").arg(type, colorFilter.isEmpty() ? "true" : "false");
+        if (!colorFilter.isEmpty()) { args << QString("-s%1ImageFilter=%2").arg(type, colorFilter); }
+    }
+    args << "-dDetectDuplicateImages=true"
+         << "-dSubsetFonts=true"
+         << "-dCompressFonts=true";
+    return args;
+}
+
+const QString CyanPDFCore::getPresetName(const int &preset)
+{
+    switch (preset) {
+    case Preset::Press:
+        return "press";
+    case Preset::Digital:
+        return "digital";
+    case Preset::Proof:
+        return "proof";
+    default:;
+    }
+    return QString();
+}
+
+const int CyanPDFCore::getPreset(const QString &name)
+{
+    for (const int preset : {Preset::Press, Preset::Digital, Preset::Proof}) {
+        if (getPresetName(preset) == name.toLower()) { return preset; }
+    }
+    return -1;
+}
+
+const int CyanPDFCore::getColorspace(const QString &profile)
+{
+    return CyanPDFProfiles::getProfile(profile).colorspace;
+}
+
+const QStringList CyanPDFCore::getProfiles(const int &colorspace)
+{
+    CyanPDFTrace::Span span("getProfiles");
+    QStringList profiles;
+    const auto index = CyanPDFProfiles::getProfiles();
+    for (const auto &profile : index) {
+        if (profile.colorspace == colorspace &&
+            CyanPDFProfiles::isUsable(profile)) { profiles << profile.path; }
+    }
+    return profiles;
+}
+
+const QString CyanPDFCore::getProfileName(const QString &profile)
+{
+    const QString result = CyanPDFProfiles::getProfile(profile).description;
+    return result.isEmpty() ? profile : result;
+}
+
+const bool CyanPDFCore::isPDF(const QString &filename)
+{
+    CyanPDFTrace::Span span("isPDF", filename);
+    return CyanPDFFileType::isPDF(filename);
+}
+
+const bool CyanPDFCore::isICC(const QString &filename)
+{
+    CyanPDFTrace::Span span("isICC", filename);
+    return CyanPDFFileType::isICC(filename);
+}
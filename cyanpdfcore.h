@@ -0,0 +1,71 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFCORE_H
+#define CYANPDFCORE_H
+
+#include <QString>
+#include <QStringList>
+
+class CyanPDFCore
+{
+public:
+    enum RenderIntent {
+        Perceptual,
+        Colorimetric,
+        Saturation,
+        AbsoluteColorimetric,
+        NoIntent
+    };
+
+    enum ColorSpace {
+        RGB,
+        CMYK,
+        GRAY,
+        NA
+    };
+
+    enum Preset {
+        Press,
+        Digital,
+        Proof
+    };
+
+    static const QString getGhostscript(bool pathOnly = false);
+    static const QString findGhostscript();
+    static const QString getGhostscriptVersion();
+
+    static const QString getPostscript(const QString &profile);
+
+    static const QString getCachePath();
+    static const QString getChecksum(const QString &filename);
+
+    static const QStringList getConvertArgs(const QString &inputFile,
+                                            const QString &outputFile,
+                                            const QString &outputIcc,
+                                            const QString defRgbIcc,
+                                            const QString defGrayIcc,
+                                            const QString defCmykIcc,
+                                            const int &colorSpace = ColorSpace::CMYK,
+                                            const int &renderIntent = RenderIntent::Colorimetric,
+                                            const bool &blackPoint = true,
+                                            const bool &overrideIcc = true,
+                                            const int &preset = Preset::Press);
+    static const QStringList getMergeArgs(const QStringList &inputFiles,
+                                          const QString &outputFile,
+                                          const QString &outputIcc);
+    static const QStringList getPresetArgs(const int &preset);
+    static const QString getPresetName(const int &preset);
+    static const int getPreset(const QString &name);
+
+    static const int getColorspace(const QString &profile);
+    static const QStringList getProfiles(const int &colorspace);
+    static const QString getProfileName(const QString &profile);
+
+    static const bool isPDF(const QString &filename);
+    static const bool isICC(const QString &filename);
+};
+
+#endif // CYANPDFCORE_H
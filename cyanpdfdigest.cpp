@@ -0,0 +1,232 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfdigest.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCache>
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QCryptographicHash>
+
+#include <cstdint>
+#include <cstring>
+
+#define CYANPDF_DIGEST_CHUNK (4 * 1024 * 1024)
+#define CYANPDF_DIGEST_MAX_ENTRIES 1024
+
+namespace {
+
+// XXH64, see https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+class XXH64
+{
+public:
+    explicit XXH64(uint64_t seed = 0)
+        : mTotal(0)
+        , mMemSize(0)
+    {
+        mV[0] = seed + P1 + P2;
+        mV[1] = seed + P2;
+        mV[2] = seed;
+        mV[3] = seed - P1;
+    }
+
+    void update(const uint8_t *data, size_t length)
+    {
+        const uint8_t *end = data + length;
+        mTotal += length;
+
+        if (mMemSize + length < 32) {
+            std::memcpy(mMem + mMemSize, data, length);
+            mMemSize += length;
+            return;
+        }
+        if (mMemSize > 0) {
+            const size_t fill = 32 - mMemSize;
+            std::memcpy(mMem + mMemSize, data, fill);
+            for (int i = 0; i < 4; ++i) { mV[i] = round(mV[i], read64(mMem + i * 8)); }
+            data += fill;
+            mMemSize = 0;
+        }
+        while (data + 32 <= end) {
+            for (int i = 0; i < 4; ++i) { mV[i] = round(mV[i], read64(data + i * 8)); }
+            data += 32;
+        }
+        if (data < end) {
+            mMemSize = size_t(end - data);
+            std::memcpy(mMem, data, mMemSize);
+        }
+    }
+
+    uint64_t digest() const
+    {
+        uint64_t h;
+        if (mTotal >= 32) {
+            h = rotl(mV[0], 1) + rotl(mV[1], 7) + rotl(mV[2], 12) + rotl(mV[3], 18);
+            for (int i = 0; i < 4; ++i) { h = merge(h, mV[i]); }
+        } else {
+            h = mV[2] + P5;
+        }
+        h += mTotal;
+
+        const uint8_t *p = mMem;
+        const uint8_t *end = mMem + mMemSize;
+        while (p + 8 <= end) {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * P1 + P4;
+            p += 8;
+        }
+        if (p + 4 <= end) {
+            h ^= uint64_t(read32(p)) * P1;
+            h = rotl(h, 23) * P2 + P3;
+            p += 4;
+        }
+        while (p < end) {
+            h ^= (*p) * P5;
+            h = rotl(h, 11) * P1;
+            ++p;
+        }
+
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static constexpr uint64_t P1 = 11400714785074694791ULL;
+    static constexpr uint64_t P2 = 14029467366897019727ULL;
+    static constexpr uint64_t P3 = 1609587929392839161ULL;
+    static constexpr uint64_t P4 = 9650029242287828579ULL;
+    static constexpr uint64_t P5 = 2870177450012600261ULL;
+
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t round(uint64_t acc, uint64_t input)
+    {
+        acc += input * P2;
+        acc = rotl(acc, 31);
+        return acc * P1;
+    }
+    static uint64_t merge(uint64_t acc, uint64_t value)
+    {
+        acc ^= round(0, value);
+        return acc * P1 + P4;
+    }
+    static uint64_t read64(const uint8_t *p)
+    {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i) { value = (value << 8) | p[i]; }
+        return value;
+    }
+    static uint32_t read32(const uint8_t *p)
+    {
+        return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+    }
+
+    uint64_t mV[4];
+    uint64_t mTotal;
+    uint8_t mMem[32];
+    size_t mMemSize;
+};
+
+struct DigestEntry
+{
+    qint64 modified = 0;
+    qint64 size = 0;
+    QString digest;
+};
+
+}
+
+static QMutex digestMutex;
+static QWaitCondition digestCondition;
+static QCache<QString, DigestEntry> digestIndex(CYANPDF_DIGEST_MAX_ENTRIES);
+static QSet<QString> digestPending;
+
+const QString CyanPDFDigest::getDigest(const QString &filename,
+                                       const Algorithm &algorithm)
+{
+    const QFileInfo info(filename);
+    if (!info.isFile()) { return QString(); }
+
+    const QString key = QString("%1:%2").arg(QString::number(algorithm), info.absoluteFilePath());
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    const qint64 size = info.size();
+
+    QMutexLocker lock(&digestMutex);
+    while (true) {
+        const DigestEntry *cached = digestIndex.object(key);
+        if (cached &&
+            cached->modified == modified &&
+            cached->size == size) { return cached->digest; }
+        if (!digestPending.contains(key)) { break; }
+        digestCondition.wait(&digestMutex);
+    }
+    digestPending.insert(key);
+    lock.unlock();
+
+    const QString digest = computeDigest(info.absoluteFilePath(), algorithm);
+
+    lock.relock();
+    digestPending.remove(key);
+    if (!digest.isEmpty()) {
+        DigestEntry *entry = new DigestEntry;
+        entry->modified = modified;
+        entry->size = size;
+        entry->digest = digest;
+        digestIndex.insert(key, entry);
+    }
+    digestCondition.wakeAll();
+    return digest;
+}
+
+const QString CyanPDFDigest::computeDigest(const QString &filename,
+                                           const Algorithm &algorithm)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) { return QString(); }
+
+    const qint64 size = file.size();
+    XXH64 fast;
+    QCryptographicHash sha(QCryptographicHash::Sha256);
+    const auto add = [&](const char *data, qint64 length) {
+        if (algorithm == Algorithm::Sha256) {
+            sha.addData(QByteArray::fromRawData(data, length));
+        } else {
+            fast.update(reinterpret_cast<const uint8_t*>(data), size_t(length));
+        }
+    };
+
+    uchar *mapped = size > 0 ? file.map(0, size) : nullptr;
+    if (mapped) {
+        for (qint64 offset = 0; offset < size; offset += CYANPDF_DIGEST_CHUNK) {
+            add(reinterpret_cast<const char*>(mapped) + offset, qMin<qint64>(CYANPDF_DIGEST_CHUNK, size - offset));
+        }
+        file.unmap(mapped);
+    } else {
+        QByteArray buffer(CYANPDF_DIGEST_CHUNK, Qt::Uninitialized);
+        qint64 length;
+        while ((length = file.read(buffer.data(), buffer.size())) > 0) { add(buffer.constData(), length); }
+        if (length < 0) { return QString(); }
+    }
+    file.close();
+
+    if (algorithm == Algorithm::Sha256) { return sha.result().toHex(); }
+    return QString("%1").arg(fast.digest(), 16, 16, QChar('0'));
+}
+
+void CyanPDFDigest::prefetch(const QString &filename)
+{
+    QThreadPool::globalInstance()->start([filename]() {
+        getDigest(filename, Algorithm::Fast);
+    });
+}
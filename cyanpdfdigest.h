@@ -0,0 +1,26 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFDIGEST_H
+#define CYANPDFDIGEST_H
+
+#include <QString>
+
+class CyanPDFDigest
+{
+public:
+    enum Algorithm {
+        Fast,
+        Sha256
+    };
+
+    static const QString getDigest(const QString &filename,
+                                   const Algorithm &algorithm = Algorithm::Fast);
+    static const QString computeDigest(const QString &filename,
+                                       const Algorithm &algorithm = Algorithm::Fast);
+    static void prefetch(const QString &filename);
+};
+
+#endif // CYANPDFDIGEST_H
@@ -0,0 +1,84 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdffiletype.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+
+// readers accept junk before the header, same window as the shared MIME database
+#define CYANPDF_FILETYPE_PDF_WINDOW 1024
+#define CYANPDF_FILETYPE_ICC_HEADER 128
+#define CYANPDF_FILETYPE_ICC_OFFSET 36
+#define CYANPDF_FILETYPE_MAX_ENTRIES 4096
+
+namespace {
+
+struct FileTypeEntry
+{
+    qint64 modified = 0;
+    qint64 size = 0;
+    CyanPDFFileType::Type type = CyanPDFFileType::Unknown;
+};
+
+}
+
+static QMutex fileTypeMutex;
+static QCache<QString, FileTypeEntry> fileTypeIndex(CYANPDF_FILETYPE_MAX_ENTRIES);
+
+const CyanPDFFileType::Type CyanPDFFileType::getType(const QString &filename)
+{
+    if (filename.isEmpty()) { return Type::Unknown; }
+    const QFileInfo info(filename);
+    if (!info.isFile()) { return Type::Unknown; }
+
+    const QString path = info.absoluteFilePath();
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    const qint64 size = info.size();
+    {
+        QMutexLocker lock(&fileTypeMutex);
+        const FileTypeEntry *cached = fileTypeIndex.object(path);
+        if (cached &&
+            cached->modified == modified &&
+            cached->size == size) { return cached->type; }
+    }
+
+    const Type type = readType(path);
+    FileTypeEntry *entry = new FileTypeEntry;
+    entry->modified = modified;
+    entry->size = size;
+    entry->type = type;
+
+    QMutexLocker lock(&fileTypeMutex);
+    fileTypeIndex.insert(path, entry);
+    return type;
+}
+
+const CyanPDFFileType::Type CyanPDFFileType::readType(const QString &filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) { return Type::Unknown; }
+    const QByteArray header = file.read(CYANPDF_FILETYPE_PDF_WINDOW);
+    file.close();
+
+    if (header.size() >= CYANPDF_FILETYPE_ICC_HEADER &&
+        header.mid(CYANPDF_FILETYPE_ICC_OFFSET, 4) == "acsp") { return Type::ICC; }
+    if (header.contains("%PDF-")) { return Type::PDF; }
+    return Type::Unknown;
+}
+
+const bool CyanPDFFileType::isPDF(const QString &filename)
+{
+    return getType(filename) == Type::PDF;
+}
+
+const bool CyanPDFFileType::isICC(const QString &filename)
+{
+    return getType(filename) == Type::ICC;
+}
@@ -0,0 +1,26 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFFILETYPE_H
+#define CYANPDFFILETYPE_H
+
+#include <QString>
+
+class CyanPDFFileType
+{
+public:
+    enum Type {
+        Unknown,
+        PDF,
+        ICC
+    };
+
+    static const Type getType(const QString &filename);
+    static const Type readType(const QString &filename);
+    static const bool isPDF(const QString &filename);
+    static const bool isICC(const QString &filename);
+};
+
+#endif // CYANPDFFILETYPE_H
@@ -0,0 +1,247 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfghostscript.h"
+#include "cyanpdfcore.h"
+
+#include <QLibrary>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QThreadPool>
+
+#include <vector>
+
+// libgs is loaded at runtime, so the prototypes from iapi.h are repeated here
+#if defined(Q_OS_WIN) && !defined(_WIN64)
+#define CYANPDF_GSDLLCALL __stdcall
+#else
+#define CYANPDF_GSDLLCALL
+#endif
+
+#define CYANPDF_GS_ERROR_QUIT -101
+#define CYANPDF_GS_ARG_ENCODING_UTF8 1
+
+namespace {
+
+struct Revision
+{
+    const char *product;
+    const char *copyright;
+    long revision;
+    long revisiondate;
+};
+
+typedef int (CYANPDF_GSDLLCALL *ReadFn)(void *handle, char *data, int length);
+typedef int (CYANPDF_GSDLLCALL *WriteFn)(void *handle, const char *data, int length);
+typedef int (CYANPDF_GSDLLCALL *PollFn)(void *handle);
+
+typedef int (CYANPDF_GSDLLCALL *RevisionProc)(Revision *revision, int length);
+typedef int (CYANPDF_GSDLLCALL *NewInstanceProc)(void **instance, void *handle);
+typedef void (CYANPDF_GSDLLCALL *DeleteInstanceProc)(void *instance);
+typedef int (CYANPDF_GSDLLCALL *SetStdioProc)(void *instance, ReadFn in, WriteFn out, WriteFn err);
+typedef int (CYANPDF_GSDLLCALL *SetPollProc)(void *instance, PollFn poll);
+typedef int (CYANPDF_GSDLLCALL *SetArgEncodingProc)(void *instance, int encoding);
+typedef int (CYANPDF_GSDLLCALL *InitWithArgsProc)(void *instance, int argc, char **argv);
+typedef int (CYANPDF_GSDLLCALL *ExitProc)(void *instance);
+
+struct Api
+{
+    bool loaded = false;
+    QString library;
+    QString revision;
+    RevisionProc revisionProc = nullptr;
+    NewInstanceProc newInstance = nullptr;
+    DeleteInstanceProc deleteInstance = nullptr;
+    SetStdioProc setStdio = nullptr;
+    SetPollProc setPoll = nullptr;
+    SetArgEncodingProc setArgEncoding = nullptr;
+    InitWithArgsProc initWithArgs = nullptr;
+    ExitProc exit = nullptr;
+};
+
+Api gsApi;
+QMutex gsMutex;
+bool gsResolved = false;
+
+int CYANPDF_GSDLLCALL handleInput(void *, char *, int)
+{
+    return 0;
+}
+
+struct Instance;
+int CYANPDF_GSDLLCALL handleOutput(void *handle, const char *data, int length);
+int CYANPDF_GSDLLCALL handlePoll(void *handle);
+
+// a libgs built without GS_THREADSAFE allows one instance per process, so a
+// single thread owns it and runs every job. gs can not re-initialize an
+// instance after gsapi_exit, so a fresh one is created and configured ahead
+// of the next job. that saves loading the library and starting a process,
+// gsapi_init_with_args still reads fonts, resources and init files each job
+struct Instance
+{
+    void *handle = nullptr;
+    std::shared_ptr<CyanPDFGhostscript::Run> run;
+
+    ~Instance() { release(); }
+
+    bool prepare()
+    {
+        if (handle) { return true; }
+        if (gsApi.newInstance(&handle, this) < 0) {
+            handle = nullptr;
+            return false;
+        }
+        gsApi.setStdio(handle, handleInput, handleOutput, handleOutput);
+        if (gsApi.setPoll) { gsApi.setPoll(handle, handlePoll); }
+        if (gsApi.setArgEncoding) { gsApi.setArgEncoding(handle, CYANPDF_GS_ARG_ENCODING_UTF8); }
+        return true;
+    }
+
+    void release()
+    {
+        if (!handle) { return; }
+        gsApi.deleteInstance(handle);
+        handle = nullptr;
+    }
+};
+
+Instance gsInstance;
+
+int CYANPDF_GSDLLCALL handleOutput(void *handle, const char *data, int length)
+{
+    const auto instance = static_cast<Instance*>(handle);
+    const auto run = instance ? instance->run : nullptr;
+    if (!run || length < 1) { return length; }
+    QMutexLocker lock(&run->mutex);
+    if (run->receiver && run->output) {
+        const QByteArray chunk(data, length);
+        const auto output = run->output;
+        QMetaObject::invokeMethod(run->receiver, [output, chunk]() { output(chunk); }, Qt::QueuedConnection);
+    }
+    return length;
+}
+
+int CYANPDF_GSDLLCALL handlePoll(void *handle)
+{
+    const auto instance = static_cast<Instance*>(handle);
+    return instance && instance->run && instance->run->canceled ? -1 : 0;
+}
+
+QThreadPool *getPool()
+{
+    static QThreadPool *pool = nullptr;
+    QMutexLocker lock(&gsMutex);
+    if (!pool) {
+        pool = new QThreadPool();
+        pool->setMaxThreadCount(1);
+        // the thread owns the instance, keep it alive
+        pool->setExpiryTimeout(-1);
+    }
+    return pool;
+}
+
+}
+
+const bool CyanPDFGhostscript::isAvailable()
+{
+#ifdef Q_OS_WIN
+    const QString bin = QFileInfo(CyanPDFCore::getGhostscript()).absolutePath();
+#endif
+    QMutexLocker lock(&gsMutex);
+    if (gsResolved) { return gsApi.loaded; }
+    gsResolved = true;
+
+    QStringList candidates;
+    const QString custom = qEnvironmentVariable("CYANPDF_LIBGS");
+    if (!custom.isEmpty()) { candidates << custom; }
+#ifdef Q_OS_WIN
+    candidates << bin + "/gsdll64.dll" << bin + "/gsdll32.dll" << "gsdll64" << "gsdll32";
+#elif defined(Q_OS_MAC)
+    candidates << "libgs" << "/opt/homebrew/lib/libgs.dylib" << "/usr/local/lib/libgs.dylib";
+#else
+    candidates << "libgs.so.10" << "libgs.so.9" << "libgs";
+#endif
+
+    QLibrary library;
+    for (const QString &candidate : std::as_const(candidates)) {
+        library.setFileName(candidate);
+        if (library.load()) { break; }
+    }
+    if (!library.isLoaded()) { return false; }
+
+    Api api;
+    api.library = library.fileName();
+    api.revisionProc = reinterpret_cast<RevisionProc>(library.resolve("gsapi_revision"));
+    api.newInstance = reinterpret_cast<NewInstanceProc>(library.resolve("gsapi_new_instance"));
+    api.deleteInstance = reinterpret_cast<DeleteInstanceProc>(library.resolve("gsapi_delete_instance"));
+    api.setStdio = reinterpret_cast<SetStdioProc>(library.resolve("gsapi_set_stdio"));
+    api.setPoll = reinterpret_cast<SetPollProc>(library.resolve("gsapi_set_poll"));
+    api.setArgEncoding = reinterpret_cast<SetArgEncodingProc>(library.resolve("gsapi_set_arg_encoding"));
+    api.initWithArgs = reinterpret_cast<InitWithArgsProc>(library.resolve("gsapi_init_with_args"));
+    api.exit = reinterpret_cast<ExitProc>(library.resolve("gsapi_exit"));
+    if (!api.revisionProc ||
+        !api.newInstance ||
+        !api.deleteInstance ||
+        !api.setStdio ||
+        !api.initWithArgs ||
+        !api.exit) {
+        library.unload();
+        return false;
+    }
+
+    Revision revision = {};
+    if (api.revisionProc(&revision, sizeof(revision)) != 0) {
+        library.unload();
+        return false;
+    }
+    api.revision = QString("%1.%2.%3").arg(revision.revision / 1000)
+                                      .arg((revision.revision % 1000) / 10, 2, 10, QChar('0'))
+                                      .arg(revision.revision % 10);
+    api.loaded = true;
+    gsApi = api;
+    return true;
+}
+
+const QString CyanPDFGhostscript::getLibrary()
+{
+    return isAvailable() ? gsApi.library : QString();
+}
+
+const QString CyanPDFGhostscript::getRevision()
+{
+    return isAvailable() ? gsApi.revision : QString();
+}
+
+void CyanPDFGhostscript::run(const QStringList &args,
+                             const std::shared_ptr<Run> &run)
+{
+    getPool()->start([args, run]() {
+        int code = CYANPDF_GS_UNAVAILABLE;
+        if (isAvailable() && gsInstance.prepare()) {
+            std::vector<QByteArray> data;
+            data.emplace_back("gs");
+            for (const QString &arg : args) { data.emplace_back(arg.toUtf8()); }
+            std::vector<char*> argv;
+            for (QByteArray &arg : data) { argv.push_back(arg.data()); }
+
+            gsInstance.run = run;
+            code = gsApi.initWithArgs(gsInstance.handle, int(argv.size()), argv.data());
+            if (code == CYANPDF_GS_ERROR_QUIT) { code = 0; }
+            const int exitCode = gsApi.exit(gsInstance.handle);
+            if (code == 0) { code = exitCode; }
+            gsInstance.run.reset();
+            gsInstance.release();
+            gsInstance.prepare();
+        }
+
+        if (run->canceled && !run->outputFile.isEmpty()) { QFile::remove(run->outputFile); }
+        QMutexLocker lock(&run->mutex);
+        if (run->receiver && run->finished) {
+            const auto finished = run->finished;
+            QMetaObject::invokeMethod(run->receiver, [finished, code]() { finished(code); }, Qt::QueuedConnection);
+        }
+    });
+}
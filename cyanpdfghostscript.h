@@ -0,0 +1,40 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFGHOSTSCRIPT_H
+#define CYANPDFGHOSTSCRIPT_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#define CYANPDF_GS_UNAVAILABLE -1000
+
+class CyanPDFGhostscript
+{
+public:
+    struct Run
+    {
+        QMutex mutex;
+        QObject *receiver = nullptr;
+        std::function<void(const QByteArray &output)> output;
+        std::function<void(int code)> finished;
+        std::atomic<bool> canceled {false};
+        QString outputFile;
+    };
+
+    static const bool isAvailable();
+    static const QString getLibrary();
+    static const QString getRevision();
+    static void run(const QStringList &args,
+                    const std::shared_ptr<Run> &run);
+};
+
+#endif // CYANPDFGHOSTSCRIPT_H
@@ -0,0 +1,305 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfink.h"
+#include "cyanpdfcore.h"
+#include "cyanpdfresources.h"
+#include "cyanpdftrace.h"
+
+#include <QPdfDocument>
+#include <QProcess>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CYANPDF_INK_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+struct Coverage
+{
+    quint32 max = 0;
+    quint64 sum = 0;
+    quint64 over = 0;
+};
+
+#ifdef CYANPDF_INK_SSE2
+// total ink of four CMYK pixels, one per 32-bit lane
+inline __m128i sumPixels(const uchar *src)
+{
+    const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+    const __m128i pairs = _mm_add_epi32(_mm_and_si128(pixels, mask),
+                                        _mm_and_si128(_mm_srli_epi32(pixels, 8), mask));
+    return _mm_add_epi32(_mm_and_si128(pairs, _mm_set1_epi32(0xFFFF)),
+                         _mm_srli_epi32(pairs, 16));
+}
+#endif
+
+inline void addPixel(const quint32 &ink,
+                     const quint32 &threshold,
+                     uchar *heat,
+                     Coverage &coverage)
+{
+    if (ink > coverage.max) { coverage.max = ink; }
+    coverage.sum += ink;
+    if (ink > threshold) { ++coverage.over; }
+    if (heat) { *heat = uchar(ink >> 2); }
+}
+
+void scanRow(const uchar *src,
+             uchar *heat,
+             const int &width,
+             const quint32 &threshold,
+             Coverage &coverage)
+{
+    int x = 0;
+#ifdef CYANPDF_INK_SSE2
+    if (width >= 16) {
+        const __m128i limit = _mm_set1_epi32(int(threshold));
+        __m128i max = _mm_setzero_si128();
+        __m128i sum = _mm_setzero_si128();
+        __m128i over = _mm_setzero_si128();
+        for (; x + 16 <= width; x += 16) {
+            const uchar *pixels = src + x * 4;
+            const __m128i s0 = sumPixels(pixels);
+            const __m128i s1 = sumPixels(pixels + 16);
+            const __m128i s2 = sumPixels(pixels + 32);
+            const __m128i s3 = sumPixels(pixels + 48);
+            // sums fit in the low 16 bits of each lane, so the 16-bit max is exact
+            max = _mm_max_epi16(max, _mm_max_epi16(_mm_max_epi16(s0, s1), _mm_max_epi16(s2, s3)));
+            sum = _mm_add_epi32(sum, _mm_add_epi32(_mm_add_epi32(s0, s1), _mm_add_epi32(s2, s3)));
+            over = _mm_sub_epi32(over, _mm_cmpgt_epi32(s0, limit));
+            over = _mm_sub_epi32(over, _mm_cmpgt_epi32(s1, limit));
+            over = _mm_sub_epi32(over, _mm_cmpgt_epi32(s2, limit));
+            over = _mm_sub_epi32(over, _mm_cmpgt_epi32(s3, limit));
+            if (heat) {
+                const __m128i low = _mm_srli_epi16(_mm_packs_epi32(s0, s1), 2);
+                const __m128i high = _mm_srli_epi16(_mm_packs_epi32(s2, s3), 2);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(heat + x), _mm_packus_epi16(low, high));
+            }
+        }
+        alignas(16) quint32 lanes[3][4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes[0]), max);
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes[1]), sum);
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes[2]), over);
+        for (int i = 0; i < 4; ++i) {
+            if (lanes[0][i] > coverage.max) { coverage.max = lanes[0][i]; }
+            coverage.sum += lanes[1][i];
+            coverage.over += lanes[2][i];
+        }
+    }
+#endif
+    // SWAR on 64-bit words, two pixels at a time
+    for (; x + 2 <= width; x += 2) {
+        quint64 pixels;
+        std::memcpy(&pixels, src + x * 4, sizeof(pixels));
+        const quint64 pairs = (pixels & 0x00FF00FF00FF00FFULL) + ((pixels >> 8) & 0x00FF00FF00FF00FFULL);
+        const quint64 sums = (pairs & 0x0000FFFF0000FFFFULL) + ((pairs >> 16) & 0x0000FFFF0000FFFFULL);
+        const quint32 first = quint32(sums & 0xFFFFFFFF);
+        const quint32 second = quint32(sums >> 32);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        addPixel(first, threshold, heat ? heat + x : nullptr, coverage);
+        addPixel(second, threshold, heat ? heat + x + 1 : nullptr, coverage);
+#else
+        addPixel(second, threshold, heat ? heat + x : nullptr, coverage);
+        addPixel(first, threshold, heat ? heat + x + 1 : nullptr, coverage);
+#endif
+    }
+    for (; x < width; ++x) {
+        const uchar *pixel = src + x * 4;
+        addPixel(quint32(pixel[0]) + pixel[1] + pixel[2] + pixel[3], threshold, heat ? heat + x : nullptr, coverage);
+    }
+}
+
+const QList<CyanPDFInk::Page> getRange(const QString &filename,
+                                       const int &first,
+                                       const int &last,
+                                       const int &limit,
+                                       const bool &heatmaps,
+                                       const int &dpi)
+{
+    const auto limits = CyanPDFResources::getLimits(CyanPDFResources::acquire());
+    QProcess proc;
+    proc.setStandardErrorFile(QProcess::nullDevice());
+    QStringList args = CyanPDFResources::getRasterArgs(limits);
+    args << "-q"
+         << "-dNOPAUSE"
+         << "-dBATCH"
+         << "-dSAFER"
+         << "-sDEVICE=pamcmyk32"
+         << QString("-r%1").arg(dpi)
+         << QString("-dFirstPage=%1").arg(first)
+         << QString("-dLastPage=%1").arg(last)
+         << "-sstdout=%stderr"
+         << "-sOutputFile=-"
+         << filename;
+    proc.start(CyanPDFCore::getGhostscript(), args);
+    if (!proc.waitForStarted()) {
+        CyanPDFResources::release();
+        return {};
+    }
+
+    // pages arrive back to back as PAM images, each is measured and dropped as soon as it is complete
+    QList<CyanPDFInk::Page> pages;
+    QByteArray buffer;
+    bool running = true;
+    while (running) {
+        running = proc.waitForReadyRead(-1);
+        buffer.append(proc.readAllStandardOutput());
+        qsizetype pos = 0;
+        while (true) {
+            const qsizetype end = buffer.indexOf("ENDHDR\n", pos);
+            if (end < 0) { break; }
+            int width = 0;
+            int height = 0;
+            int depth = 0;
+            for (const QByteArray &line : buffer.mid(pos, end - pos).split('\n')) {
+                if (line.startsWith("WIDTH ")) { width = line.mid(6).toInt(); }
+                else if (line.startsWith("HEIGHT ")) { height = line.mid(7).toInt(); }
+                else if (line.startsWith("DEPTH ")) { depth = line.mid(6).toInt(); }
+            }
+            if (width < 1 || height < 1 || depth != 4) {
+                proc.kill();
+                proc.waitForFinished();
+                CyanPDFResources::release();
+                return {};
+            }
+            const qsizetype start = end + 7;
+            const qsizetype size = qsizetype(width) * height * 4;
+            if (buffer.size() - start < size) { break; }
+            pages << CyanPDFInk::getPage(reinterpret_cast<const uchar*>(buffer.constData() + start),
+                                         width,
+                                         height,
+                                         qsizetype(width) * 4,
+                                         limit,
+                                         heatmaps);
+            pos = start + size;
+        }
+        buffer.remove(0, pos);
+    }
+    proc.waitForFinished(-1);
+    CyanPDFResources::release();
+    if (proc.exitStatus() != QProcess::NormalExit ||
+        proc.exitCode() != 0 ||
+        pages.count() != last - first + 1) { return {}; }
+    return pages;
+}
+
+}
+
+const CyanPDFInk::Report CyanPDFInk::getReport(const QString &filename,
+                                               const int &limit,
+                                               const bool &heatmaps,
+                                               const int &dpi)
+{
+    CyanPDFTrace::Span span("getInkReport", filename);
+    Report report;
+    report.limit = limit;
+    if (!CyanPDFCore::isPDF(filename) || CyanPDFCore::getGhostscript().isEmpty()) { return report; }
+
+    int count = 0;
+    {
+        QPdfDocument doc;
+        if (doc.load(filename) != QPdfDocument::Error::None) { return report; }
+        count = doc.pageCount();
+    }
+    if (count < 1) { return report; }
+
+    QList<QPair<int, int>> ranges;
+    const int chunks = qMin(count, qMax(1, QThread::idealThreadCount()));
+    for (int i = 0; i < chunks; ++i) {
+        const int first = i * count / chunks + 1;
+        const int last = (i + 1) * count / chunks;
+        ranges << qMakePair(first, last);
+    }
+
+    // Ghostscript does the rendering, the threads mostly wait on it
+    QThreadPool pool;
+    pool.setMaxThreadCount(chunks);
+    const QList<QList<Page>> results = QtConcurrent::blockingMapped(&pool, ranges, [&](const QPair<int, int> &range) {
+        return getRange(filename, range.first, range.second, limit, heatmaps, dpi);
+    });
+    for (const auto &result : results) {
+        if (result.isEmpty()) { return report; }
+        report.pages << result;
+    }
+
+    for (int i = 0; i < report.pages.count(); ++i) {
+        const Page &page = report.pages.at(i);
+        if (page.max > report.max) {
+            report.max = page.max;
+            report.maxPage = i;
+        }
+        report.average += page.average / report.pages.count();
+        if (page.max > limit) { report.pagesOver << i; }
+    }
+    report.valid = true;
+    return report;
+}
+
+const CyanPDFInk::Page CyanPDFInk::getPage(const uchar *cmyk,
+                                           const int &width,
+                                           const int &height,
+                                           const qsizetype &bytesPerLine,
+                                           const int &limit,
+                                           const bool &heatmap)
+{
+    Page page;
+    if (!cmyk || width < 1 || height < 1) { return page; }
+    if (heatmap) {
+        page.heatmap = QImage(width, height, QImage::Format_Indexed8);
+        page.heatmap.setColorTable(getHeatmapColors(limit));
+    }
+
+    Coverage coverage;
+    const quint32 threshold = quint32(qMax(0, limit)) * 255 / 100;
+    for (int y = 0; y < height; ++y) {
+        scanRow(cmyk + y * bytesPerLine,
+                heatmap ? page.heatmap.scanLine(y) : nullptr,
+                width,
+                threshold,
+                coverage);
+    }
+
+    const double pixels = double(width) * height;
+    page.max = coverage.max * 100.0 / 255.0;
+    page.average = coverage.sum * 100.0 / (255.0 * pixels);
+    page.over = coverage.over * 100.0 / pixels;
+    return page;
+}
+
+const QImage CyanPDFInk::getHeatmap(const QString &filename,
+                                    const int &page,
+                                    const int &limit,
+                                    const int &dpi)
+{
+    CyanPDFTrace::Span span("getInkHeatmap", filename);
+    if (page < 0 || CyanPDFCore::getGhostscript().isEmpty()) { return QImage(); }
+    const QList<Page> pages = getRange(filename, page + 1, page + 1, limit, true, dpi);
+    return pages.isEmpty() ? QImage() : pages.first().heatmap;
+}
+
+const QList<QRgb> CyanPDFInk::getHeatmapColors(const int &limit)
+{
+    QList<QRgb> colors;
+    for (int i = 0; i < 256; ++i) {
+        const double ink = i * 400.0 / 255.0;
+        if (ink > limit) {
+            colors << qRgba(255, 0, 0, 200);
+        } else if (ink > limit - 40) {
+            const double t = (ink - limit + 40) / 40.0;
+            colors << qRgba(255, int(220 - 100 * t), 0, int(60 + 100 * t));
+        } else {
+            colors << qRgba(0, 0, 0, 0);
+        }
+    }
+    return colors;
+}
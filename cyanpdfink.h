@@ -0,0 +1,56 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFINK_H
+#define CYANPDFINK_H
+
+#include <QImage>
+#include <QList>
+#include <QString>
+
+#define CYANPDF_INK_LIMIT 300
+#define CYANPDF_INK_DPI 72
+
+class CyanPDFInk
+{
+public:
+    struct Page
+    {
+        double max = 0;
+        double average = 0;
+        double over = 0;
+        QImage heatmap;
+    };
+
+    struct Report
+    {
+        bool valid = false;
+        int limit = CYANPDF_INK_LIMIT;
+        double max = 0;
+        double average = 0;
+        int maxPage = -1;
+        QList<Page> pages;
+        QList<int> pagesOver;
+    };
+
+    // total ink in percent (0-400), heat maps are Indexed8 with one step per 4/255 of ink
+    static const Report getReport(const QString &filename,
+                                  const int &limit = CYANPDF_INK_LIMIT,
+                                  const bool &heatmaps = false,
+                                  const int &dpi = CYANPDF_INK_DPI);
+    static const Page getPage(const uchar *cmyk,
+                              const int &width,
+                              const int &height,
+                              const qsizetype &bytesPerLine,
+                              const int &limit,
+                              const bool &heatmap);
+    static const QImage getHeatmap(const QString &filename,
+                                   const int &page,
+                                   const int &limit = CYANPDF_INK_LIMIT,
+                                   const int &dpi = CYANPDF_INK_DPI);
+    static const QList<QRgb> getHeatmapColors(const int &limit);
+};
+
+#endif // CYANPDFINK_H
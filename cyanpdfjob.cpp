@@ -0,0 +1,698 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfjob.h"
+#include "cyanpdfcache.h"
+#include "cyanpdfpreflight.h"
+#include "cyanpdftrace.h"
+#include "cyanpdfresources.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QPdfDocument>
+#include <QImage>
+#include <QtConcurrent>
+#include <QEventLoop>
+#include <QMutexLocker>
+
+#include <cmath>
+#include <algorithm>
+
+#define CYANPDF_JOB_COMPARE_DPI 150
+#define CYANPDF_JOB_COMPARE_MAX 4096
+#define CYANPDF_JOB_COMPARE_DELTA 48
+#define CYANPDF_JOB_COPY_CHUNK (1024 * 1024)
+
+namespace {
+
+// copies in chunks so a cancel does not wait for a multi-GB document
+bool copyFile(const QString &source,
+              const QString &target,
+              const std::atomic<bool> &canceled)
+{
+    QFile input(source);
+    if (!input.open(QIODevice::ReadOnly)) { return false; }
+    const bool stream = CyanPDFJob::isStream(target);
+    QFile output;
+    if (stream) {
+        if (!output.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered)) { return false; }
+    } else {
+        QFile::remove(target);
+        output.setFileName(target);
+        if (!output.open(QIODevice::WriteOnly)) { return false; }
+    }
+
+    bool copied = true;
+    while (copied && !input.atEnd()) {
+        const QByteArray data = input.read(CYANPDF_JOB_COPY_CHUNK);
+        copied = !canceled && !data.isEmpty() && output.write(data) == data.size();
+    }
+    output.close();
+    if (!copied && !stream) { QFile::remove(target); }
+    return copied;
+}
+
+}
+
+CyanPDFJob::CyanPDFJob(const Settings &settings,
+                       QObject *parent)
+    : QObject(parent)
+    , mSettings(settings)
+    , mStage(Stage::Idle)
+    , mStageStart(-1)
+    , mPrepareWatcher(nullptr)
+    , mCopyWatcher(nullptr)
+    , mCompareWatcher(nullptr)
+    , mStoreWatcher(nullptr)
+    , mPages(0)
+    , mPagesDone(0)
+    , mCanceled(false)
+    , mCached(false)
+    , mPassedThrough(false)
+    , mFinished(false)
+    , mUseLibrary(settings.useLibrary)
+    , mElapsed(0)
+{
+}
+
+const CyanPDFJob::Settings &CyanPDFJob::settings() const
+{
+    return mSettings;
+}
+
+const QString &CyanPDFJob::log() const
+{
+    return mLog;
+}
+
+qint64 CyanPDFJob::elapsed() const
+{
+    return isRunning() ? mTimer.elapsed() : mElapsed;
+}
+
+bool CyanPDFJob::isRunning() const
+{
+    return mStage != Stage::Idle;
+}
+
+bool CyanPDFJob::isCanceled() const
+{
+    return mCanceled;
+}
+
+bool CyanPDFJob::isCached() const
+{
+    return mCached;
+}
+
+bool CyanPDFJob::isPassedThrough() const
+{
+    return mPassedThrough;
+}
+
+CyanPDFJob::Stage CyanPDFJob::stage() const
+{
+    return mStage;
+}
+
+const char *CyanPDFJob::getStageName(const Stage &stage)
+{
+    switch (stage) {
+    case Stage::Prepare:
+        return "prepare";
+    case Stage::Convert:
+        return "convert";
+    case Stage::Shards:
+        return "shards";
+    case Stage::Merge:
+        return "merge";
+    case Stage::Verify:
+        return "verify";
+    default:;
+    }
+    return "idle";
+}
+
+const int CyanPDFJob::getPageCount(const QString &filename)
+{
+    QPdfDocument doc;
+    if (doc.load(filename) != QPdfDocument::Error::None) { return 0; }
+    return doc.pageCount();
+}
+
+const bool CyanPDFJob::isSamePDF(const QString &filename,
+                                 const QString &reference,
+                                 QString *error)
+{
+    QPdfDocument doc;
+    QPdfDocument ref;
+    if (doc.load(filename) != QPdfDocument::Error::None ||
+        ref.load(reference) != QPdfDocument::Error::None) {
+        if (error) { *error = tr("Unable to load documents for comparison."); }
+        return false;
+    }
+    if (doc.pageCount() != ref.pageCount()) {
+        if (error) { *error = tr("Page count differs (%1 vs %2).").arg(doc.pageCount()).arg(ref.pageCount()); }
+        return false;
+    }
+
+    for (int page = 0; page < doc.pageCount(); ++page) {
+        const QSizeF docSize = doc.pagePointSize(page);
+        const QSizeF refSize = ref.pagePointSize(page);
+        if (std::abs(docSize.width() - refSize.width()) > 0.5 ||
+            std::abs(docSize.height() - refSize.height()) > 0.5) {
+            if (error) { *error = tr("Page %1 size differs.").arg(page + 1); }
+            return false;
+        }
+
+        QSize size = (docSize * CYANPDF_JOB_COMPARE_DPI / 72.0).toSize();
+        if (qMax(size.width(), size.height()) > CYANPDF_JOB_COMPARE_MAX) {
+            size.scale(CYANPDF_JOB_COMPARE_MAX, CYANPDF_JOB_COMPARE_MAX, Qt::KeepAspectRatio);
+        }
+        const QImage docImage = doc.render(page, size).convertToFormat(QImage::Format_RGB32);
+        const QImage refImage = ref.render(page, size).convertToFormat(QImage::Format_RGB32);
+        if (docImage.size() != refImage.size() || docImage.isNull()) {
+            if (error) { *error = tr("Unable to render page %1 for comparison.").arg(page + 1); }
+            return false;
+        }
+
+        // anti-aliasing may move an edge by a shade, anything beyond that on more than
+        // a few pixels is a real difference
+        qint64 changed = 0;
+        for (int y = 0; y < docImage.height(); ++y) {
+            const QRgb *a = reinterpret_cast<const QRgb*>(docImage.constScanLine(y));
+            const QRgb *b = reinterpret_cast<const QRgb*>(refImage.constScanLine(y));
+            for (int x = 0; x < docImage.width(); ++x) {
+                const int delta = qMax(std::abs(qRed(a[x]) - qRed(b[x])),
+                                       qMax(std::abs(qGreen(a[x]) - qGreen(b[x])),
+                                            std::abs(qBlue(a[x]) - qBlue(b[x]))));
+                if (delta > CYANPDF_JOB_COMPARE_DELTA) { ++changed; }
+            }
+        }
+        if (changed > qint64(docImage.width()) * docImage.height() / 10000) {
+            if (error) { *error = tr("Page %1 differs from the single-pass conversion.").arg(page + 1); }
+            return false;
+        }
+    }
+    return true;
+}
+
+const bool CyanPDFJob::isStream(const QString &filename)
+{
+    return filename == "-";
+}
+
+const bool CyanPDFJob::convert(const Settings &settings,
+                               QString *error,
+                               QString *log)
+{
+    // runs the job on a local event loop, so it can be called from any thread
+    CyanPDFJob job(settings);
+    QEventLoop loop;
+    bool success = false;
+    connect(&job, &CyanPDFJob::finished,
+            &loop, [&loop, &success, error](bool ok, const QString &message) {
+        success = ok;
+        if (error) { *error = message; }
+        loop.quit();
+    });
+    job.start();
+    loop.exec();
+    if (log) { *log = job.log(); }
+    return success;
+}
+
+void CyanPDFJob::start()
+{
+    if (isRunning()) { return; }
+    mTimer.start();
+    mLog.clear();
+    mPages = 0;
+    mPagesDone = 0;
+    mCanceled = false;
+    mCached = false;
+    mPassedThrough = false;
+    mFinished = false;
+    mCacheKey.clear();
+    mAbort = std::make_shared<std::atomic<bool>>(false);
+
+    mGhostscript = CyanPDFCore::getGhostscript();
+    if (!QFile::exists(mGhostscript)) {
+        done(false, tr("Ghostscript not found."));
+        return;
+    }
+    if (!CyanPDFCore::isPDF(mSettings.inputFile)) {
+        done(false, tr("Input is not a PDF document."));
+        return;
+    }
+    if (!isStream(mSettings.outputFile) &&
+        QFileInfo(mSettings.inputFile).absoluteFilePath() ==
+        QFileInfo(mSettings.outputFile).absoluteFilePath()) {
+        done(false, tr("Input and output are the same file."));
+        return;
+    }
+
+    // hashing, preflighting and loading large documents must not block the caller's thread
+    setStage(Stage::Prepare);
+    mPrepareWatcher = new QFutureWatcher<Prepared>(this);
+    connect(mPrepareWatcher, &QFutureWatcher<Prepared>::finished,
+            this, [this]() {
+        const Prepared prepared = mPrepareWatcher->result();
+        mPrepareWatcher->deleteLater();
+        mPrepareWatcher = nullptr;
+        startConversion(prepared);
+    });
+    const Settings settings = mSettings;
+    mPrepareWatcher->setFuture(QtConcurrent::run([settings]() {
+        Prepared prepared;
+        if (settings.useCache) {
+            prepared.cacheKey = CyanPDFCache::getKey(settings);
+            prepared.cached = CyanPDFCache::lookup(prepared.cacheKey);
+        }
+        if (settings.passThrough) {
+            prepared.compliant = CyanPDFPreflight::isCompliant(CyanPDFPreflight::getReport(settings.inputFile),
+                                                               settings.outputIcc,
+                                                               settings.defGrayIcc,
+                                                               settings.defCmykIcc,
+                                                               settings.renderIntent,
+                                                               settings.blackPoint,
+                                                               settings.overrideIcc,
+                                                               settings.preset,
+                                                               &prepared.reason);
+        }
+        if (!prepared.compliant && prepared.cached.isEmpty()) { prepared.pages = getPageCount(settings.inputFile); }
+        return prepared;
+    }));
+}
+
+void CyanPDFJob::startConversion(const Prepared &prepared)
+{
+    mCacheKey = prepared.cacheKey;
+    mPages = prepared.pages;
+    if (prepared.compliant || !prepared.cached.isEmpty()) {
+        startCopy(prepared);
+        return;
+    }
+    if (mSettings.passThrough && !prepared.reason.isEmpty()) { mLog.append(tr("Preflight: %1\n").arg(prepared.reason)); }
+
+    if (mSettings.shards > 1 && mPages > 1) {
+        startShards();
+        return;
+    }
+
+    const QStringList args = getArgs(mSettings.inputFile, mSettings.outputFile);
+    if (args.count() < 1) {
+        done(false, tr("Unable to generate Ghostscript arguments."));
+        return;
+    }
+    setStage(Stage::Convert);
+    startProcess(args);
+}
+
+void CyanPDFJob::startCopy(const Prepared &prepared)
+{
+    const QString source = prepared.compliant ? mSettings.inputFile : prepared.cached;
+    mCopyWatcher = new QFutureWatcher<bool>(this);
+    connect(mCopyWatcher, &QFutureWatcher<bool>::finished,
+            this, [this, prepared, source]() {
+        const bool copied = mCopyWatcher->result();
+        mCopyWatcher->deleteLater();
+        mCopyWatcher = nullptr;
+        if (copied) {
+            if (prepared.compliant) {
+                mPassedThrough = true;
+                mLog.append(tr("Input already matches the output profile, passed through without conversion.\n"));
+            } else {
+                mCached = true;
+                mLog.append(tr("Using cached result %1\n").arg(source));
+            }
+            done(true, QString());
+            return;
+        }
+        // fall back to the cached result, then to converting
+        Prepared next = prepared;
+        if (prepared.compliant) { next.compliant = false; }
+        else { next.cached.clear(); }
+        startConversion(next);
+    });
+    const QString target = mSettings.outputFile;
+    const auto abort = mAbort;
+    mCopyWatcher->setFuture(QtConcurrent::run([source, target, abort]() {
+        return copyFile(source, target, *abort);
+    }));
+}
+
+const bool CyanPDFJob::writeStream(const QByteArray &data)
+{
+    if (!mStream) {
+        mStream = std::make_unique<QFile>();
+        if (!mStream->open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered)) { return false; }
+    }
+    return mStream->write(data) == data.size();
+}
+
+void CyanPDFJob::cancel()
+{
+    if (!isRunning()) { return; }
+    mCanceled = true;
+    done(false, tr("Conversion canceled."));
+}
+
+const QStringList CyanPDFJob::getArgs(const QString &inputFile,
+                                      const QString &outputFile) const
+{
+    return CyanPDFCore::getConvertArgs(inputFile,
+                                       outputFile,
+                                       mSettings.outputIcc,
+                                       mSettings.defRgbIcc,
+                                       mSettings.defGrayIcc,
+                                       mSettings.defCmykIcc,
+                                       CyanPDFCore::getColorspace(mSettings.outputIcc),
+                                       mSettings.renderIntent,
+                                       mSettings.blackPoint,
+                                       mSettings.overrideIcc,
+                                       mSettings.preset);
+}
+
+void CyanPDFJob::startProcess(const QStringList &args)
+{
+    const auto limits = CyanPDFResources::getLimits(CyanPDFResources::acquire());
+    const QStringList tuned = CyanPDFResources::getArgs(limits) + args;
+    // the document is written to our stdout, which only the executable can do,
+    // and libgs runs one job at a time, which would serialize the shards
+    if (mUseLibrary &&
+        mStage != Stage::Shards &&
+        CyanPDFGhostscript::isAvailable() &&
+        !isStream(mSettings.outputFile)) { startLibrary(tuned); }
+    else { startExecutable(tuned); }
+}
+
+void CyanPDFJob::startExecutable(const QStringList &args)
+{
+    const auto proc = new QProcess(this);
+    const bool streaming = args.contains("-sOutputFile=-");
+    if (streaming) {
+        // messages go to stderr so stdout only carries the document
+        proc->setProcessChannelMode(QProcess::SeparateChannels);
+        connect(proc, &QProcess::readyReadStandardOutput,
+                this, [this, proc]() {
+            if (!writeStream(proc->readAllStandardOutput())) { done(false, tr("Unable to write to standard output.")); }
+        });
+        connect(proc, &QProcess::readyReadStandardError,
+                this, [this, proc]() { handleOutput(proc, proc->readAllStandardError()); });
+    } else {
+        proc->setProcessChannelMode(QProcess::MergedChannels);
+        connect(proc, &QProcess::readyRead,
+                this, [this, proc]() { handleOutput(proc, proc->readAll()); });
+    }
+    connect(proc, &QProcess::finished,
+            this, [this, proc, streaming](int exitCode, QProcess::ExitStatus exitStatus) {
+        if (streaming && !writeStream(proc->readAllStandardOutput())) {
+            mProcs.removeAll(proc);
+            proc->deleteLater();
+            CyanPDFResources::release();
+            done(false, tr("Unable to write to standard output."));
+            return;
+        }
+        const QByteArray remaining = streaming ? proc->readAllStandardError() : proc->readAll();
+        if (!remaining.isEmpty()) { handleOutput(proc, remaining); }
+        mProcs.removeAll(proc);
+        proc->deleteLater();
+        handleFinished(proc, exitCode, exitStatus != QProcess::NormalExit);
+    });
+    connect(proc, &QProcess::errorOccurred,
+            this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            done(false, tr("Failed to start Ghostscript."));
+        }
+    });
+    mProcs << proc;
+    if (CyanPDFTrace::isEnabled()) { mRunStarts.insert(proc, CyanPDFTrace::now()); }
+    mPagesDone = 0;
+    emit progress(0, mPages);
+    proc->start(mGhostscript, streaming ? QStringList({"-sstdout=%stderr"}) + args : args);
+}
+
+void CyanPDFJob::startLibrary(const QStringList &args)
+{
+    const auto run = std::make_shared<CyanPDFGhostscript::Run>();
+    const auto source = run.get();
+    run->receiver = this;
+    run->output = [this, source](const QByteArray &output) { handleOutput(source, output); };
+    run->finished = [this, source, args](int code) {
+        // queued before the job was canceled, done() has already cleaned up
+        if (mFinished) { return; }
+        for (int i = 0; i < mRuns.count(); ++i) {
+            if (mRuns.at(i).get() == source) { mRuns.removeAt(i); break; }
+        }
+        if (code == CYANPDF_GS_UNAVAILABLE) {
+            // no more instances could be created in this process, use the executable instead
+            mBuffers.remove(source);
+            mRunStarts.remove(source);
+            mLog.append(tr("libgs instance unavailable, falling back to %1\n").arg(mGhostscript));
+            mUseLibrary = false;
+            startExecutable(args);
+            return;
+        }
+        handleFinished(source, code, false);
+    };
+    for (const QString &arg : args) {
+        if (arg.startsWith("-sOutputFile=")) { run->outputFile = arg.mid(13); }
+    }
+    mRuns << run;
+    if (CyanPDFTrace::isEnabled()) { mRunStarts.insert(source, CyanPDFTrace::now()); }
+    mPagesDone = 0;
+    emit progress(0, mPages);
+    CyanPDFGhostscript::run(args, run);
+}
+
+void CyanPDFJob::setStage(const Stage &stage)
+{
+    if (mStage != Stage::Idle) { CyanPDFTrace::complete(getStageName(mStage), mStageStart, mSettings.inputFile); }
+    mStage = stage;
+    mStageStart = CyanPDFTrace::isEnabled() ? CyanPDFTrace::now() : -1;
+}
+
+void CyanPDFJob::startShards()
+{
+    mTempDir = std::make_unique<QTemporaryDir>(QString("%1/job-XXXXXX").arg(CyanPDFCore::getCachePath()));
+    if (!mTempDir->isValid()) {
+        done(false, tr("Unable to create temporary folder."));
+        return;
+    }
+
+    const int shards = qMin(mSettings.shards, mPages);
+    const int pagesPerShard = (mPages + shards - 1) / shards;
+    QList<QStringList> shardArgs;
+    for (int first = 1; first <= mPages; first += pagesPerShard) {
+        const int last = qMin(first + pagesPerShard - 1, mPages);
+        const QString shardFile = mTempDir->filePath(QString("shard-%1.pdf").arg(shardArgs.count(), 4, 10, QChar('0')));
+        QStringList args = getArgs(mSettings.inputFile, shardFile);
+        if (args.count() < 1) {
+            done(false, tr("Unable to generate Ghostscript arguments."));
+            return;
+        }
+        args.prepend(QString("-dLastPage=%1").arg(last));
+        args.prepend(QString("-dFirstPage=%1").arg(first));
+        // embed complete fonts in the shards so the merge pass can deduplicate and subset them once
+        args.erase(std::remove_if(args.begin(), args.end(), [](const QString &arg) {
+            return arg.startsWith("-dSubsetFonts=");
+        }), args.end());
+        args.prepend("-dSubsetFonts=false");
+        shardArgs << args;
+        mShardFiles << shardFile;
+    }
+
+    setStage(Stage::Shards);
+    for (const QStringList &args : shardArgs) { startProcess(args); }
+}
+
+void CyanPDFJob::startMerge()
+{
+    // the shards are already converted, so the merge only joins them and subsets the fonts
+    const QStringList args = CyanPDFCore::getMergeArgs(mShardFiles,
+                                                       mSettings.outputFile,
+                                                       mSettings.outputIcc);
+    if (args.count() < 1) {
+        done(false, tr("Unable to generate Ghostscript arguments."));
+        return;
+    }
+    setStage(Stage::Merge);
+    startProcess(args);
+}
+
+void CyanPDFJob::startVerify()
+{
+    const QStringList args = getArgs(mSettings.inputFile, mTempDir->filePath("reference.pdf"));
+    if (args.count() < 1) {
+        done(false, tr("Unable to generate Ghostscript arguments."));
+        return;
+    }
+    setStage(Stage::Verify);
+    startProcess(args);
+}
+
+void CyanPDFJob::startCompare()
+{
+    // rendering every page of both documents takes a while, keep it off the caller's thread
+    mCompareWatcher = new QFutureWatcher<QPair<bool, QString>>(this);
+    connect(mCompareWatcher, &QFutureWatcher<QPair<bool, QString>>::finished,
+            this, [this]() {
+        const auto result = mCompareWatcher->result();
+        mCompareWatcher->deleteLater();
+        mCompareWatcher = nullptr;
+        done(result.first, result.second);
+    });
+    const QString output = mSettings.outputFile;
+    const QString reference = mTempDir->filePath("reference.pdf");
+    mCompareWatcher->setFuture(QtConcurrent::run([output, reference]() {
+        QString error;
+        const bool same = isSamePDF(output, reference, &error);
+        return qMakePair(same, error);
+    }));
+}
+
+void CyanPDFJob::done(bool success,
+                      const QString &error)
+{
+    if (mFinished) { return; }
+    mFinished = true;
+
+    const bool hasOutput = mStage == Stage::Convert ||
+                           mStage == Stage::Merge ||
+                           mStage == Stage::Verify;
+    setStage(Stage::Idle);
+    mElapsed = mTimer.isValid() ? mTimer.elapsed() : 0;
+
+    if (mAbort) { *mAbort = true; }
+    if (mPrepareWatcher) {
+        disconnect(mPrepareWatcher, nullptr, this, nullptr);
+        mPrepareWatcher->deleteLater();
+        mPrepareWatcher = nullptr;
+    }
+    if (mCopyWatcher) {
+        disconnect(mCopyWatcher, nullptr, this, nullptr);
+        mCopyWatcher->deleteLater();
+        mCopyWatcher = nullptr;
+    }
+    if (mCompareWatcher) {
+        disconnect(mCompareWatcher, nullptr, this, nullptr);
+        mCompareWatcher->deleteLater();
+        mCompareWatcher = nullptr;
+    }
+
+    for (const auto proc : mProcs) {
+        disconnect(proc, nullptr, this, nullptr);
+        proc->kill();
+        proc->deleteLater();
+    }
+    CyanPDFResources::release(mProcs.count() + mRuns.count());
+    mProcs.clear();
+    for (const auto &run : std::as_const(mRuns)) {
+        QMutexLocker lock(&run->mutex);
+        run->receiver = nullptr;
+        run->canceled = true;
+    }
+    mRuns.clear();
+    mBuffers.clear();
+    mRunStarts.clear();
+    mShardFiles.clear();
+    mTempDir.reset();
+
+    const bool streamed = isStream(mSettings.outputFile);
+    if (mStream) { mStream->close(); }
+    mStream.reset();
+    if (!success && hasOutput && !streamed) { QFile::remove(mSettings.outputFile); }
+    if (success && !streamed && !mCached && !mPassedThrough && !mCacheKey.isEmpty()) {
+        // copying the result into the cache and evicting takes as long as the copy to the output
+        const QString key = mCacheKey;
+        const QString output = mSettings.outputFile;
+        mStoreWatcher = new QFutureWatcher<void>(this);
+        connect(mStoreWatcher, &QFutureWatcher<void>::finished,
+                this, [this, success, error]() {
+            mStoreWatcher->deleteLater();
+            mStoreWatcher = nullptr;
+            emit finished(success, error);
+        });
+        mStoreWatcher->setFuture(QtConcurrent::run([key, output]() { CyanPDFCache::store(key, output); }));
+        return;
+    }
+
+    QMetaObject::invokeMethod(this, [this, success, error]() {
+        emit finished(success, error);
+    }, Qt::QueuedConnection);
+}
+
+void CyanPDFJob::handleOutput(const void *source,
+                              const QByteArray &output)
+{
+    static QRegularExpression pagesRegex("^Processing pages (\\d+) through (\\d+)\\.");
+    static QRegularExpression pageRegex("^Page (\\d+)$");
+
+    QByteArray &buffer = mBuffers[source];
+    buffer.append(output);
+    int index;
+    while ((index = buffer.indexOf('\n')) != -1) {
+        const QString line = QString::fromUtf8(buffer.left(index)).trimmed();
+        buffer.remove(0, index + 1);
+        mLog.append(line + "\n");
+
+        const auto pagesMatch = pagesRegex.match(line);
+        if (pagesMatch.hasMatch() && mPages < 1) {
+            mPages = pagesMatch.captured(2).toInt() - pagesMatch.captured(1).toInt() + 1;
+            emit progress(mPagesDone, mPages);
+        } else if (pageRegex.match(line).hasMatch()) {
+            emit progress(++mPagesDone, mPages);
+        }
+    }
+}
+
+void CyanPDFJob::handleFinished(const void *source,
+                                int exitCode,
+                                bool crashed)
+{
+    // done() has already released every run it stopped
+    if (mFinished) { return; }
+    CyanPDFResources::release();
+
+    if (mRunStarts.contains(source)) {
+        CyanPDFTrace::complete("ghostscript", mRunStarts.take(source), mSettings.inputFile);
+    }
+    const QByteArray remaining = mBuffers.take(source);
+    if (!remaining.isEmpty()) { mLog.append(QString::fromUtf8(remaining)); }
+
+    if (crashed) {
+        done(false, tr("Ghostscript crashed."));
+        return;
+    }
+    if (exitCode != 0) {
+        done(false, tr("Ghostscript failed with exit code %1.").arg(exitCode));
+        return;
+    }
+    if (!mProcs.isEmpty() || !mRuns.isEmpty()) { return; }
+
+    switch (mStage) {
+    case Stage::Shards:
+        startMerge();
+        break;
+    case Stage::Convert:
+    case Stage::Merge:
+        if (isStream(mSettings.outputFile)) {
+            done(true, QString());
+        } else if (!CyanPDFCore::isPDF(mSettings.outputFile)) {
+            done(false, tr("Ghostscript did not produce a PDF document."));
+        } else if (mStage == Stage::Merge && mSettings.verifyShards) {
+            startVerify();
+        } else {
+            done(true, QString());
+        }
+        break;
+    case Stage::Verify:
+        startCompare();
+        break;
+    default:;
+    }
+}
@@ -0,0 +1,146 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFJOB_H
+#define CYANPDFJOB_H
+
+#include <QObject>
+#include <QProcess>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QHash>
+#include <QPair>
+#include <QFutureWatcher>
+#include <QFile>
+
+#include <atomic>
+#include <memory>
+
+#include "cyanpdfcore.h"
+#include "cyanpdfghostscript.h"
+
+class CyanPDFJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Settings
+    {
+        QString inputFile;
+        QString outputFile;
+        QString outputIcc;
+        QString defRgbIcc;
+        QString defGrayIcc;
+        QString defCmykIcc;
+        int renderIntent = CyanPDFCore::RenderIntent::Colorimetric;
+        bool blackPoint = true;
+        bool overrideIcc = true;
+        int preset = CyanPDFCore::Preset::Press;
+        int shards = 1;
+        bool verifyShards = false;
+        bool useCache = true;
+        bool passThrough = true;
+        bool useLibrary = true;
+        QString id;
+    };
+
+    enum Stage {
+        Idle,
+        Prepare,
+        Convert,
+        Shards,
+        Merge,
+        Verify
+    };
+
+    explicit CyanPDFJob(const Settings &settings,
+                        QObject *parent = nullptr);
+
+    const Settings &settings() const;
+    const QString &log() const;
+    qint64 elapsed() const;
+    bool isRunning() const;
+    bool isCanceled() const;
+    bool isCached() const;
+    bool isPassedThrough() const;
+    Stage stage() const;
+
+    static const char *getStageName(const Stage &stage);
+    static const int getPageCount(const QString &filename);
+    static const bool isSamePDF(const QString &filename,
+                                const QString &reference,
+                                QString *error = nullptr);
+    static const bool isStream(const QString &filename);
+    static const bool convert(const Settings &settings,
+                              QString *error = nullptr,
+                              QString *log = nullptr);
+
+    void start();
+    void cancel();
+
+signals:
+    void progress(int page, int pages);
+    void finished(bool success, const QString &error);
+
+private:
+    struct Prepared
+    {
+        QString cacheKey;
+        QString cached;
+        bool compliant = false;
+        QString reason;
+        int pages = 0;
+    };
+
+    const QStringList getArgs(const QString &inputFile,
+                              const QString &outputFile) const;
+    void startConversion(const Prepared &prepared);
+    void startCopy(const Prepared &prepared);
+    const bool writeStream(const QByteArray &data);
+    void startProcess(const QStringList &args);
+    void startExecutable(const QStringList &args);
+    void startLibrary(const QStringList &args);
+    void setStage(const Stage &stage);
+    void startShards();
+    void startMerge();
+    void startVerify();
+    void startCompare();
+    void done(bool success, const QString &error);
+    void handleOutput(const void *source,
+                      const QByteArray &output);
+    void handleFinished(const void *source,
+                        int exitCode,
+                        bool crashed);
+
+    const Settings mSettings;
+    Stage mStage;
+    qint64 mStageStart;
+    QString mGhostscript;
+    QList<QProcess*> mProcs;
+    QList<std::shared_ptr<CyanPDFGhostscript::Run>> mRuns;
+    QHash<const void*, QByteArray> mBuffers;
+    QHash<const void*, qint64> mRunStarts;
+    QStringList mShardFiles;
+    QString mCacheKey;
+    QFutureWatcher<Prepared> *mPrepareWatcher;
+    QFutureWatcher<bool> *mCopyWatcher;
+    QFutureWatcher<QPair<bool, QString>> *mCompareWatcher;
+    QFutureWatcher<void> *mStoreWatcher;
+    std::shared_ptr<std::atomic<bool>> mAbort;
+    std::unique_ptr<QTemporaryDir> mTempDir;
+    std::unique_ptr<QFile> mStream;
+    QString mLog;
+    int mPages;
+    int mPagesDone;
+    bool mCanceled;
+    bool mCached;
+    bool mPassedThrough;
+    bool mFinished;
+    bool mUseLibrary;
+    QElapsedTimer mTimer;
+    qint64 mElapsed;
+};
+
+#endif // CYANPDFJOB_H
@@ -0,0 +1,1000 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfpreflight.h"
+#include "cyanpdfprofiles.h"
+#include "cyanpdfcore.h"
+
+#include <QObject>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QHash>
+#include <QCache>
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <zlib.h>
+
+#define CYANPDF_PREFLIGHT_MAX_DEPTH 64
+#define CYANPDF_PREFLIGHT_MAX_STREAM (256 * 1024 * 1024)
+#define CYANPDF_PREFLIGHT_MAX_REPORTS 256
+
+namespace {
+
+struct Value
+{
+    enum Type {
+        Null,
+        Bool,
+        Number,
+        String,
+        Name,
+        Array,
+        Dict,
+        Ref,
+        Keyword
+    };
+
+    Type type = Null;
+    double number = 0;
+    int ref = -1;
+    QByteArray string;
+    std::vector<Value> array;
+    std::vector<std::pair<QByteArray, Value>> dict;
+
+    const Value *get(const QByteArray &key) const
+    {
+        for (const auto &entry : dict) {
+            if (entry.first == key) { return &entry.second; }
+        }
+        return nullptr;
+    }
+    bool isName(const char *name) const { return type == Name && string == name; }
+    bool isKeyword(const char *keyword) const { return type == Keyword && string == keyword; }
+};
+
+struct Entry
+{
+    Value value;
+    qint64 streamOffset = -1;
+    qint64 streamLength = 0;
+};
+
+struct ReportEntry
+{
+    qint64 modified = 0;
+    qint64 size = 0;
+    CyanPDFPreflight::Report report;
+};
+
+bool isWhitespace(const char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\0';
+}
+
+bool isDelimiter(const char c)
+{
+    switch (c) {
+    case '(':
+    case ')':
+    case '<':
+    case '>':
+    case '[':
+    case ']':
+    case '{':
+    case '}':
+    case '/':
+    case '%':
+        return true;
+    default:;
+    }
+    return isWhitespace(c);
+}
+
+bool isDigit(const char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+const QByteArray inflateStream(const char *data,
+                               const qint64 &size,
+                               const qint64 &limit,
+                               bool *complete = nullptr)
+{
+    QByteArray result;
+    if (complete) { *complete = false; }
+    if (size <= 0 || size > CYANPDF_PREFLIGHT_MAX_STREAM) { return result; }
+
+    z_stream stream = {};
+    if (inflateInit(&stream) != Z_OK) { return result; }
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = uInt(size);
+
+    // broken or truncated streams are common, keep whatever was decoded
+    QByteArray buffer(64 * 1024, Qt::Uninitialized);
+    int status = Z_OK;
+    do {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer.data());
+        stream.avail_out = uInt(buffer.size());
+        status = inflate(&stream, Z_NO_FLUSH);
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) { break; }
+        result.append(buffer.constData(), buffer.size() - qsizetype(stream.avail_out));
+        if (result.size() > limit) { break; }
+    } while (status != Z_STREAM_END && stream.avail_out == 0);
+    inflateEnd(&stream);
+    if (complete) { *complete = status == Z_STREAM_END && result.size() <= limit; }
+    return result;
+}
+
+const QString decodeText(const QByteArray &text)
+{
+    if (text.size() >= 2 && uchar(text.at(0)) == 0xfe && uchar(text.at(1)) == 0xff) {
+        QString result;
+        for (qsizetype i = 2; i + 1 < text.size(); i += 2) {
+            result.append(QChar(ushort(uchar(text.at(i)) << 8 | uchar(text.at(i + 1)))));
+        }
+        return result;
+    }
+    return QString::fromLatin1(text);
+}
+
+const QString getColorspaceName(const QByteArray &name,
+                                const bool &inlineImage = false)
+{
+    if (name == "DeviceRGB" || (inlineImage && name == "RGB")) { return "DeviceRGB"; }
+    if (name == "DeviceCMYK" || (inlineImage && name == "CMYK")) { return "DeviceCMYK"; }
+    if (name == "DeviceGray" || (inlineImage && name == "G")) { return "DeviceGray"; }
+    if (name == "Indexed" || (inlineImage && name == "I")) { return "Indexed"; }
+    if (name == "CalRGB" ||
+        name == "CalGray" ||
+        name == "Lab" ||
+        name == "Separation" ||
+        name == "DeviceN" ||
+        name == "Pattern") { return QString::fromLatin1(name); }
+    return QString();
+}
+
+class Parser
+{
+public:
+    Parser(const char *data,
+           const qint64 &size,
+           const qint64 &pos = 0)
+        : mData(data)
+        , mSize(size)
+        , mPos(pos) {}
+
+    qint64 pos() const { return mPos; }
+    void setPos(const qint64 &pos) { mPos = pos; }
+
+    bool atEnd()
+    {
+        skipSpace();
+        return mPos >= mSize;
+    }
+
+    bool startsWith(const QByteArray &keyword)
+    {
+        skipSpace();
+        if (mPos + keyword.size() > mSize) { return false; }
+        if (QByteArray::fromRawData(mData + mPos, keyword.size()) != keyword) { return false; }
+        return mPos + keyword.size() == mSize || isDelimiter(mData[mPos + keyword.size()]);
+    }
+
+    void skipSpace()
+    {
+        while (mPos < mSize) {
+            const char c = mData[mPos];
+            if (isWhitespace(c)) {
+                ++mPos;
+            } else if (c == '%') {
+                while (mPos < mSize && mData[mPos] != '\n' && mData[mPos] != '\r') { ++mPos; }
+            } else {
+                break;
+            }
+        }
+    }
+
+    // always consumes input unless at the end, so callers can loop safely
+    Value parse(const int &depth = 0)
+    {
+        Value value;
+        skipSpace();
+        if (mPos >= mSize) { return value; }
+        if (depth > CYANPDF_PREFLIGHT_MAX_DEPTH) {
+            ++mPos;
+            return value;
+        }
+
+        const char c = mData[mPos];
+        switch (c) {
+        case '/':
+            value.type = Value::Name;
+            value.string = readName();
+            return value;
+        case '(':
+            value.type = Value::String;
+            value.string = readString();
+            return value;
+        case '<':
+            if (mPos + 1 < mSize && mData[mPos + 1] == '<') {
+                mPos += 2;
+                value.type = Value::Dict;
+                while (!atEnd()) {
+                    if (mData[mPos] == '>') {
+                        mPos += mPos + 1 < mSize && mData[mPos + 1] == '>' ? 2 : 1;
+                        break;
+                    }
+                    Value key = parse(depth + 1);
+                    if (key.type != Value::Name) { continue; }
+                    value.dict.emplace_back(key.string, parse(depth + 1));
+                }
+            } else {
+                value.type = Value::String;
+                value.string = readHexString();
+            }
+            return value;
+        case '[':
+            ++mPos;
+            value.type = Value::Array;
+            while (!atEnd()) {
+                if (mData[mPos] == ']') {
+                    ++mPos;
+                    break;
+                }
+                value.array.push_back(parse(depth + 1));
+            }
+            return value;
+        case ')':
+        case '>':
+        case ']':
+        case '{':
+        case '}':
+            ++mPos;
+            return value;
+        default:;
+        }
+
+        const QByteArray token = readToken();
+        if (token.isEmpty()) {
+            ++mPos;
+            return value;
+        }
+        if (isDigit(c) || c == '+' || c == '-' || c == '.') {
+            bool ok = false;
+            value.number = token.toDouble(&ok);
+            value.type = ok ? Value::Number : Value::Keyword;
+            if (!ok) { value.string = token; }
+            else if (isInteger(token)) { readRef(value); }
+            return value;
+        }
+        if (token == "true" || token == "false") {
+            value.type = Value::Bool;
+            value.number = token == "true" ? 1 : 0;
+        } else if (token != "null") {
+            value.type = Value::Keyword;
+            value.string = token;
+        }
+        return value;
+    }
+
+    const QByteArray readToken()
+    {
+        const qint64 start = mPos;
+        while (mPos < mSize && !isDelimiter(mData[mPos])) { ++mPos; }
+        return QByteArray(mData + start, mPos - start);
+    }
+
+private:
+    static bool isInteger(const QByteArray &token)
+    {
+        for (const char c : token) {
+            if (!isDigit(c)) { return false; }
+        }
+        return true;
+    }
+
+    void readRef(Value &value)
+    {
+        const qint64 start = mPos;
+        skipSpace();
+        const QByteArray generation = readToken();
+        if (!generation.isEmpty() && isInteger(generation)) {
+            skipSpace();
+            if (mPos < mSize && mData[mPos] == 'R' &&
+                (mPos + 1 == mSize || isDelimiter(mData[mPos + 1]))) {
+                ++mPos;
+                value.type = Value::Ref;
+                value.ref = int(value.number);
+                return;
+            }
+        }
+        mPos = start;
+    }
+
+    const QByteArray readName()
+    {
+        ++mPos;
+        QByteArray name;
+        while (mPos < mSize && !isDelimiter(mData[mPos])) {
+            if (mData[mPos] == '#' && mPos + 2 < mSize) {
+                name.append(char(QByteArray(mData + mPos + 1, 2).toInt(nullptr, 16)));
+                mPos += 3;
+            } else {
+                name.append(mData[mPos++]);
+            }
+        }
+        return name;
+    }
+
+    const QByteArray readString()
+    {
+        ++mPos;
+        QByteArray string;
+        int nesting = 1;
+        while (mPos < mSize) {
+            const char c = mData[mPos++];
+            if (c == '\\' && mPos < mSize) {
+                const char e = mData[mPos++];
+                switch (e) {
+                case 'n': string.append('\n'); break;
+                case 'r': string.append('\r'); break;
+                case 't': string.append('\t'); break;
+                case 'b': string.append('\b'); break;
+                case 'f': string.append('\f'); break;
+                case '\r':
+                    if (mPos < mSize && mData[mPos] == '\n') { ++mPos; }
+                    break;
+                case '\n':
+                    break;
+                default:
+                    if (e >= '0' && e <= '7') {
+                        int octal = e - '0';
+                        for (int i = 0; i < 2 && mPos < mSize && mData[mPos] >= '0' && mData[mPos] <= '7'; ++i) {
+                            octal = octal * 8 + (mData[mPos++] - '0');
+                        }
+                        string.append(char(octal));
+                    } else {
+                        string.append(e);
+                    }
+                }
+                continue;
+            }
+            if (c == '(') { ++nesting; }
+            else if (c == ')' && --nesting == 0) { break; }
+            string.append(c);
+        }
+        return string;
+    }
+
+    const QByteArray readHexString()
+    {
+        ++mPos;
+        QByteArray hex;
+        while (mPos < mSize && mData[mPos] != '>') {
+            const char c = mData[mPos++];
+            if (!isWhitespace(c)) { hex.append(c); }
+        }
+        if (mPos < mSize) { ++mPos; }
+        if (hex.size() % 2) { hex.append('0'); }
+        return QByteArray::fromHex(hex);
+    }
+
+    const char *mData;
+    qint64 mSize;
+    qint64 mPos;
+};
+
+class Document
+{
+public:
+    Document(const char *data,
+             const qint64 &size)
+        : mData(data)
+        , mSize(size)
+        , mBytes(QByteArray::fromRawData(data, size)) {}
+
+    // objects are found by scanning the file instead of trusting the xref,
+    // later definitions win, which also covers incremental updates
+    void scan()
+    {
+        qint64 pos = 0;
+        while ((pos = mBytes.indexOf("obj", pos)) >= 0) {
+            const qint64 end = pos + 3;
+            int number = -1;
+            if ((end < mSize && !isDelimiter(mData[end])) || !readObjectNumber(pos, number)) {
+                pos = end;
+                continue;
+            }
+
+            Parser parser(mData, mSize, end);
+            Entry entry;
+            entry.value = parser.parse();
+            qint64 next = parser.pos();
+            if (entry.value.type == Value::Dict && parser.startsWith("stream")) {
+                qint64 start = parser.pos() + 6;
+                if (start < mSize && mData[start] == '\r') { ++start; }
+                if (start < mSize && mData[start] == '\n') { ++start; }
+                entry.streamOffset = start;
+                entry.streamLength = getStreamLength(entry.value, start);
+                next = start + entry.streamLength;
+            }
+
+            const Value *type = entry.value.get("Type");
+            if (type && type->isName("XRef")) { addTrailer(entry.value); }
+            mObjects.insert(number, entry);
+            if (type && type->isName("ObjStm")) { expandObjectStream(entry); }
+            pos = qMax(next, end);
+        }
+
+        pos = 0;
+        while ((pos = mBytes.indexOf("trailer", pos)) >= 0) {
+            Parser parser(mData, mSize, pos + 7);
+            const Value trailer = parser.parse();
+            if (trailer.type == Value::Dict) { addTrailer(trailer); }
+            pos += 7;
+        }
+    }
+
+    const QHash<int, Entry> &objects() const { return mObjects; }
+    const Value &trailer() const { return mTrailer; }
+    bool isEncrypted() const { return mEncrypted; }
+
+    const Value *resolve(const Value *value) const
+    {
+        for (int i = 0; value && value->type == Value::Ref && i < CYANPDF_PREFLIGHT_MAX_DEPTH; ++i) {
+            const auto it = mObjects.constFind(value->ref);
+            value = it == mObjects.constEnd() ? nullptr : &it->value;
+        }
+        return value && value->type != Value::Ref ? value : nullptr;
+    }
+
+    const Entry *getEntry(const Value *value) const
+    {
+        if (!value || value->type != Value::Ref) { return nullptr; }
+        const auto it = mObjects.constFind(value->ref);
+        return it == mObjects.constEnd() ? nullptr : &it.value();
+    }
+
+    const Value *findType(const char *name) const
+    {
+        const Value *found = nullptr;
+        for (const Entry &entry : mObjects) {
+            const Value *type = entry.value.get("Type");
+            if (type && type->isName(name)) { found = &entry.value; }
+        }
+        return found;
+    }
+
+    // ok is false when the stream uses a filter we can not decode or is
+    // damaged, the result is then empty or only the part that was decoded
+    const QByteArray decode(const Entry &entry,
+                            bool *ok = nullptr) const
+    {
+        if (ok) { *ok = true; }
+        if (entry.streamOffset < 0 || entry.streamLength <= 0) { return QByteArray(); }
+        const char *data = mData + entry.streamOffset;
+        if (ok) { *ok = false; }
+
+        QList<QByteArray> filters;
+        const Value *filter = resolve(entry.value.get("Filter"));
+        if (filter && filter->type == Value::Name) {
+            filters << filter->string;
+        } else if (filter && filter->type == Value::Array) {
+            for (const Value &item : filter->array) {
+                const Value *name = resolve(&item);
+                if (name && name->type == Value::Name) { filters << name->string; }
+            }
+        }
+        if (filters.isEmpty()) {
+            if (ok) { *ok = true; }
+            return QByteArray(data, entry.streamLength);
+        }
+        if (filters.count() > 1 || (filters.first() != "FlateDecode" && filters.first() != "Fl")) {
+            return QByteArray();
+        }
+
+        const Value *parms = resolve(entry.value.get("DecodeParms"));
+        if (parms && parms->type == Value::Array && !parms->array.empty()) { parms = resolve(&parms->array.front()); }
+        if (parms && parms->type == Value::Dict) {
+            const Value *predictor = resolve(parms->get("Predictor"));
+            if (predictor && predictor->number > 1) { return QByteArray(); }
+        }
+        return inflateStream(data, entry.streamLength, CYANPDF_PREFLIGHT_MAX_STREAM, ok);
+    }
+
+private:
+    bool readObjectNumber(const qint64 &pos,
+                          int &number) const
+    {
+        qint64 p = pos - 1;
+        while (p >= 0 && isWhitespace(mData[p])) { --p; }
+        const qint64 generationEnd = p;
+        while (p >= 0 && isDigit(mData[p])) { --p; }
+        if (p == generationEnd) { return false; }
+        const qint64 space = p;
+        while (p >= 0 && isWhitespace(mData[p])) { --p; }
+        if (p == space) { return false; }
+        const qint64 numberEnd = p;
+        while (p >= 0 && isDigit(mData[p])) { --p; }
+        if (p == numberEnd || (p >= 0 && !isDelimiter(mData[p]))) { return false; }
+        bool ok = false;
+        number = QByteArray(mData + p + 1, numberEnd - p).toInt(&ok);
+        return ok;
+    }
+
+    qint64 getStreamLength(const Value &dict,
+                           const qint64 &start) const
+    {
+        const Value *length = dict.get("Length");
+        if (length && length->type == Value::Number) {
+            const qint64 size = qint64(length->number);
+            if (size >= 0 && start + size <= mSize) {
+                Parser parser(mData, mSize, start + size);
+                if (parser.startsWith("endstream")) { return size; }
+            }
+        }
+        const qint64 stop = mBytes.indexOf("endstream", start);
+        if (stop < 0) { return mSize - start; }
+        qint64 size = stop - start;
+        while (size > 0 && (mData[start + size - 1] == '\n' || mData[start + size - 1] == '\r')) { --size; }
+        return size;
+    }
+
+    void addTrailer(const Value &trailer)
+    {
+        for (const char *key : {"Root", "Info", "Encrypt"}) {
+            const Value *value = trailer.get(key);
+            if (!value) { continue; }
+            auto it = std::find_if(mTrailer.dict.begin(), mTrailer.dict.end(), [key](const auto &entry) {
+                return entry.first == key;
+            });
+            if (it != mTrailer.dict.end()) { it->second = *value; }
+            else { mTrailer.dict.emplace_back(key, *value); }
+        }
+        mTrailer.type = Value::Dict;
+        if (trailer.get("Encrypt")) { mEncrypted = true; }
+    }
+
+    void expandObjectStream(const Entry &entry)
+    {
+        const QByteArray data = decode(entry);
+        const Value *count = entry.value.get("N");
+        const Value *first = entry.value.get("First");
+        if (data.isEmpty() || !count || !first) { return; }
+
+        Parser header(data.constData(), data.size());
+        QList<QPair<int, qint64>> offsets;
+        for (int i = 0; i < int(count->number) && !header.atEnd(); ++i) {
+            const Value number = header.parse();
+            const Value offset = header.parse();
+            if (number.type != Value::Number || offset.type != Value::Number) { break; }
+            offsets.append({int(number.number), qint64(first->number + offset.number)});
+        }
+        for (const auto &offset : std::as_const(offsets)) {
+            if (offset.second < 0 || offset.second >= data.size()) { continue; }
+            Parser parser(data.constData(), data.size(), offset.second);
+            Entry object;
+            object.value = parser.parse();
+            mObjects.insert(offset.first, object);
+        }
+    }
+
+    const char *mData;
+    qint64 mSize;
+    const QByteArray mBytes;
+    QHash<int, Entry> mObjects;
+    Value mTrailer;
+    bool mEncrypted = false;
+};
+
+class Analyzer
+{
+public:
+    explicit Analyzer(const Document &document)
+        : mDocument(document) {}
+
+    // only names under a colour space key count, /Filter or /Subtype values are not colour spaces
+    void walk(const Value &value,
+              const int &depth = 0)
+    {
+        if (depth > CYANPDF_PREFLIGHT_MAX_DEPTH) { return; }
+        switch (value.type) {
+        case Value::Array:
+            for (const Value &item : value.array) { walk(item, depth + 1); }
+            break;
+        case Value::Dict:
+            for (const auto &entry : value.dict) {
+                if (entry.first == "ColorSpace" || entry.first == "CS" || entry.first == "Alternate") {
+                    walkColorspace(entry.second, depth + 1);
+                } else {
+                    walk(entry.second, depth + 1);
+                }
+            }
+            break;
+        default:;
+        }
+    }
+
+    void scanContent(const QByteArray &content)
+    {
+        Parser parser(content.constData(), content.size());
+        while (!parser.atEnd()) {
+            const Value value = parser.parse();
+            if (value.type == Value::Name) {
+                addColorspace(getColorspaceName(value.string));
+            } else if (value.type == Value::Keyword) {
+                const QByteArray &op = value.string;
+                if (op == "rg" || op == "RG") { addColorspace("DeviceRGB"); }
+                else if (op == "k" || op == "K") { addColorspace("DeviceCMYK"); }
+                else if (op == "g" || op == "G") { addColorspace("DeviceGray"); }
+                else if (op == "BI") { scanInlineImage(parser, content); }
+            }
+        }
+    }
+
+    void addFont(const Value *name)
+    {
+        const Value *font = mDocument.resolve(name);
+        mFonts.insert(font && font->type == Value::Name ? QString::fromLatin1(font->string) : QObject::tr("Unnamed"));
+    }
+
+    QSet<QString> mColorspaces;
+    QSet<int> mProfiles;
+    QSet<QString> mFonts;
+    int mInlineImages = 0;
+
+private:
+    void addColorspace(const QString &name)
+    {
+        if (!name.isEmpty()) { mColorspaces.insert(name); }
+    }
+
+    // a colour space, or a resource dictionary of named colour spaces
+    void walkColorspace(const Value &ref,
+                        const int &depth)
+    {
+        const Value *value = mDocument.resolve(&ref);
+        if (!value || depth > CYANPDF_PREFLIGHT_MAX_DEPTH) { return; }
+        switch (value->type) {
+        case Value::Name:
+            addColorspace(getColorspaceName(value->string));
+            break;
+        case Value::Array: {
+            if (value->array.empty()) { break; }
+            const Value *family = mDocument.resolve(&value->array.front());
+            if (!family || family->type != Value::Name) { break; }
+            if (family->string == "ICCBased") {
+                if (value->array.size() >= 2) { addICCBased(value->array.at(1)); }
+                break;
+            }
+            addColorspace(getColorspaceName(family->string));
+            // the base of Indexed and Pattern, the alternate of Separation and DeviceN
+            const size_t base = family->string == "Indexed" || family->string == "Pattern" ? 1 :
+                                family->string == "Separation" || family->string == "DeviceN" ? 2 : 0;
+            if (base > 0 && value->array.size() > base) { walkColorspace(value->array.at(base), depth + 1); }
+            break;
+        }
+        case Value::Dict:
+            for (const auto &entry : value->dict) { walkColorspace(entry.second, depth + 1); }
+            break;
+        default:;
+        }
+    }
+
+    void addICCBased(const Value &ref)
+    {
+        const Value *stream = mDocument.resolve(&ref);
+        const Value *components = stream ? mDocument.resolve(stream->get("N")) : nullptr;
+        switch (components ? int(components->number) : 0) {
+        case 1:
+            addColorspace("ICCBased Gray");
+            break;
+        case 3:
+            addColorspace("ICCBased RGB");
+            break;
+        case 4:
+            addColorspace("ICCBased CMYK");
+            break;
+        default:
+            addColorspace("ICCBased");
+        }
+        if (ref.type == Value::Ref) { mProfiles.insert(ref.ref); }
+    }
+
+    void scanInlineImage(Parser &parser,
+                         const QByteArray &content)
+    {
+        ++mInlineImages;
+        while (!parser.atEnd()) {
+            const Value key = parser.parse();
+            if (key.isKeyword("ID")) { break; }
+            if (key.type != Value::Name) { continue; }
+            const Value value = parser.parse();
+            if (key.string != "CS" && key.string != "ColorSpace") { continue; }
+            if (value.type == Value::Name) {
+                addColorspace(getColorspaceName(value.string, true));
+            } else if (value.type == Value::Array) {
+                for (const Value &item : value.array) {
+                    if (item.type == Value::Name) { addColorspace(getColorspaceName(item.string, true)); }
+                }
+            }
+        }
+
+        qint64 pos = parser.pos() + 1;
+        while ((pos = content.indexOf("EI", pos)) >= 0) {
+            const bool before = pos > 0 && isWhitespace(content.at(pos - 1));
+            const bool after = pos + 2 >= content.size() || isDelimiter(content.at(pos + 2));
+            pos += 2;
+            if (before && after) { break; }
+        }
+        parser.setPos(pos < 0 ? content.size() : pos);
+    }
+
+    const Document &mDocument;
+};
+
+bool isContentStream(const Value &dict)
+{
+    const Value *subtype = dict.get("Subtype");
+    if (subtype) { return subtype->isName("Form"); }
+    const Value *type = dict.get("Type");
+    if (type) { return type->isName("Pattern"); }
+    for (const char *key : {"N", "Length1", "Length2", "Length3", "FunctionType", "ShadingType", "BitsPerComponent"}) {
+        if (dict.get(key)) { return false; }
+    }
+    return true;
+}
+
+}
+
+static QMutex preflightMutex;
+static QCache<QString, ReportEntry> preflightIndex(CYANPDF_PREFLIGHT_MAX_REPORTS);
+
+const CyanPDFPreflight::Report CyanPDFPreflight::getReport(const QString &filename)
+{
+    const QFileInfo info(filename);
+    if (!info.isFile()) { return Report(); }
+
+    const QString path = info.absoluteFilePath();
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    const qint64 size = info.size();
+    {
+        QMutexLocker lock(&preflightMutex);
+        const ReportEntry *cached = preflightIndex.object(path);
+        if (cached &&
+            cached->modified == modified &&
+            cached->size == size) { return cached->report; }
+    }
+
+    ReportEntry *entry = new ReportEntry;
+    entry->modified = modified;
+    entry->size = size;
+    entry->report = scan(path);
+    const Report report = entry->report;
+
+    QMutexLocker lock(&preflightMutex);
+    preflightIndex.insert(path, entry);
+    return report;
+}
+
+const CyanPDFPreflight::Report CyanPDFPreflight::scan(const QString &filename)
+{
+    Report report;
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) { return report; }
+
+    QByteArray buffer;
+    const qint64 size = file.size();
+    uchar *mapped = size > 0 ? file.map(0, size) : nullptr;
+    if (!mapped) { buffer = file.readAll(); }
+    const char *data = mapped ? reinterpret_cast<const char*>(mapped) : buffer.constData();
+    const qint64 length = mapped ? size : buffer.size();
+
+    const QByteArray head = QByteArray::fromRawData(data, qMin<qint64>(length, 1024));
+    const qsizetype header = head.indexOf("%PDF-");
+    if (header < 0) {
+        if (mapped) { file.unmap(mapped); }
+        return report;
+    }
+    report.version = QString::fromLatin1(head.mid(header + 5, 3));
+
+    Document document(data, length);
+    document.scan();
+    report.objects = document.objects().count();
+    report.encrypted = document.isEncrypted();
+    report.valid = report.objects > 0;
+    if (!report.valid || report.encrypted) {
+        if (mapped) { file.unmap(mapped); }
+        return report;
+    }
+
+    const Value *root = document.resolve(document.trailer().get("Root"));
+    if (!root || root->type != Value::Dict) { root = document.findType("Catalog"); }
+    if (root) {
+        const Value *version = document.resolve(root->get("Version"));
+        if (version && version->type == Value::Name && version->string > report.version.toLatin1()) {
+            report.version = QString::fromLatin1(version->string);
+        }
+    }
+
+    const Value *info = document.resolve(document.trailer().get("Info"));
+    const Value *pdfx = info && info->type == Value::Dict ? document.resolve(info->get("GTS_PDFXVersion")) : nullptr;
+    if (pdfx && pdfx->type == Value::String) { report.pdfx = decodeText(pdfx->string); }
+    if (report.pdfx.isEmpty() && root) {
+        const Entry *metadata = document.getEntry(root->get("Metadata"));
+        if (metadata) {
+            static const QRegularExpression xmp("GTS_PDFXVersion(?:>|=\")([^<\"]+)");
+            const auto match = xmp.match(QString::fromUtf8(document.decode(*metadata)));
+            if (match.hasMatch()) { report.pdfx = match.captured(1).trimmed(); }
+        }
+    }
+
+    const Value *intents = root ? document.resolve(root->get("OutputIntents")) : nullptr;
+    if (intents && intents->type == Value::Array) {
+        for (const Value &item : intents->array) {
+            const Value *intent = document.resolve(&item);
+            if (!intent || intent->type != Value::Dict) { continue; }
+            const Value *subtype = document.resolve(intent->get("S"));
+            if (!subtype || !subtype->isName("GTS_PDFX")) { continue; }
+            const Value *identifier = document.resolve(intent->get("OutputConditionIdentifier"));
+            const QString name = identifier && identifier->type == Value::String ? decodeText(identifier->string) : QString();
+            report.outputIntents << (name.isEmpty() ? QObject::tr("Unnamed") : name);
+            const Entry *profile = document.getEntry(intent->get("DestOutputProfile"));
+            const QString id = profile ? CyanPDFProfiles::getProfileId(document.decode(*profile)) : QString();
+            if (!id.isEmpty()) { report.outputProfiles << id; }
+        }
+    }
+
+    Analyzer analyzer(document);
+    for (const Entry &entry : document.objects()) {
+        const Value &value = entry.value;
+        analyzer.walk(value);
+        if (value.type != Value::Dict) { continue; }
+
+        const Value *type = value.get("Type");
+        const Value *subtype = value.get("Subtype");
+        if (type && type->isName("Page")) { ++report.pages; }
+        if (subtype && subtype->isName("Image")) { ++report.images; }
+        if (type && type->isName("FontDescriptor") &&
+            !value.get("FontFile") &&
+            !value.get("FontFile2") &&
+            !value.get("FontFile3")) { analyzer.addFont(value.get("FontName")); }
+        if (type && type->isName("Font") && subtype &&
+            (subtype->isName("Type1") || subtype->isName("MMType1") || subtype->isName("TrueType")) &&
+            !value.get("FontDescriptor")) { analyzer.addFont(value.get("BaseFont")); }
+        if (entry.streamOffset >= 0 && isContentStream(value)) {
+            bool decoded = false;
+            const QByteArray content = document.decode(entry, &decoded);
+            if (!decoded) { ++report.undecodedStreams; }
+            analyzer.scanContent(content);
+        }
+    }
+    for (const int &ref : std::as_const(analyzer.mProfiles)) {
+        const auto it = document.objects().constFind(ref);
+        report.colorProfiles << (it == document.objects().constEnd() ? QString() : CyanPDFProfiles::getProfileId(document.decode(*it)));
+    }
+    if (mapped) { file.unmap(mapped); }
+
+    report.images += analyzer.mInlineImages;
+    report.iccProfiles = analyzer.mProfiles.count();
+    report.colorspaces = QStringList(analyzer.mColorspaces.begin(), analyzer.mColorspaces.end());
+    report.colorspaces.sort();
+    report.unembeddedFonts = QStringList(analyzer.mFonts.begin(), analyzer.mFonts.end());
+    report.unembeddedFonts.sort();
+    return report;
+}
+
+const bool CyanPDFPreflight::isCompliant(const Report &report,
+                                         const QString &outputIcc,
+                                         const QString &defGrayIcc,
+                                         const QString &defCmykIcc,
+                                         const int &renderIntent,
+                                         const bool &blackPoint,
+                                         const bool &overrideIcc,
+                                         const int &preset,
+                                         QString *reason)
+{
+    const auto fail = [reason](const QString &message) {
+        if (reason) { *reason = message; }
+        return false;
+    };
+
+    if (!report.valid) { return fail(QObject::tr("Unable to read the document structure.")); }
+    if (report.encrypted) { return fail(QObject::tr("Document is encrypted.")); }
+    if (report.pdfx.isEmpty()) { return fail(QObject::tr("Document is not PDF/X.")); }
+    if (preset != CyanPDFCore::Preset::Press) { return fail(QObject::tr("The preset downsamples images.")); }
+    if (report.undecodedStreams > 0) {
+        // colour operators in those streams were not seen
+        return fail(QObject::tr("Unable to check %1 content stream(s).").arg(report.undecodedStreams));
+    }
+
+    const int colorspace = CyanPDFCore::getColorspace(outputIcc);
+    const QString id = CyanPDFProfiles::getProfile(outputIcc).id;
+    if (id.isEmpty() || (colorspace != CyanPDFCore::ColorSpace::CMYK &&
+                         colorspace != CyanPDFCore::ColorSpace::GRAY)) {
+        return fail(QObject::tr("Output profile is not usable."));
+    }
+    if (report.outputIntents.count() != 1 || !report.outputProfiles.contains(id)) {
+        return fail(QObject::tr("OutputIntent does not match the output profile."));
+    }
+
+    const bool cmyk = colorspace == CyanPDFCore::ColorSpace::CMYK;
+    const QString device = cmyk ? "DeviceCMYK" : "DeviceGray";
+    const QString embedded = cmyk ? "ICCBased CMYK" : "ICCBased Gray";
+    QStringList allowed = {"DeviceGray", "Indexed", "Pattern", embedded};
+    if (cmyk) { allowed << "DeviceCMYK" << "Separation" << "DeviceN"; }
+    for (const QString &space : report.colorspaces) {
+        if (!allowed.contains(space)) { return fail(QObject::tr("Document uses %1.").arg(space)); }
+    }
+
+    // a copy only matches the conversion when every color is already in the output
+    // profile, otherwise it would be converted with the chosen intent and black point.
+    // device colors are read through the default profile, and so are embedded
+    // profiles when they are overridden
+    const QString defaultIcc = cmyk ? defCmykIcc : defGrayIcc;
+    const bool fromDefault = report.colorspaces.contains(device) ||
+                             (overrideIcc && report.colorspaces.contains(embedded));
+    const bool fromEmbedded = !overrideIcc && report.colorspaces.contains(embedded);
+    QString source;
+    if (fromDefault && CyanPDFProfiles::getProfile(defaultIcc).id != id) {
+        source = CyanPDFCore::getProfileName(defaultIcc);
+    } else if (fromEmbedded && report.colorProfiles.count(id) != report.colorProfiles.count()) {
+        source = QObject::tr("embedded profiles");
+    }
+    if (!source.isEmpty()) {
+        static const QStringList intents = {QObject::tr("perceptual"),
+                                            QObject::tr("relative colorimetric"),
+                                            QObject::tr("saturation"),
+                                            QObject::tr("absolute colorimetric"),
+                                            QObject::tr("default")};
+        return fail(QObject::tr("Colors would be converted from %1 (%2 intent, black point %3).")
+                        .arg(source,
+                             intents.value(renderIntent, intents.last()),
+                             blackPoint ? QObject::tr("on") : QObject::tr("off")));
+    }
+
+    if (!report.unembeddedFonts.isEmpty()) {
+        return fail(QObject::tr("Fonts not embedded: %1.").arg(report.unembeddedFonts.join(", ")));
+    }
+    return true;
+}
+
+const QStringList CyanPDFPreflight::verify(const QString &filename,
+                                           const QString &outputIcc)
+{
+    // scan() instead of getReport(), converted documents are rarely looked at twice
+    const Report report = scan(filename);
+    if (!report.valid) { return {QObject::tr("Unable to read the document structure.")}; }
+    if (report.encrypted) { return {QObject::tr("Document is encrypted.")}; }
+
+    QStringList problems;
+    if (report.pdfx.isEmpty()) { problems << QObject::tr("PDF/X version key is missing."); }
+
+    const QString id = CyanPDFProfiles::getProfile(outputIcc).id;
+    if (report.outputIntents.isEmpty()) { problems << QObject::tr("OutputIntent is missing."); }
+    else if (id.isEmpty() || !report.outputProfiles.contains(id)) {
+        problems << QObject::tr("OutputIntent does not match %1.").arg(CyanPDFCore::getProfileName(outputIcc));
+    }
+
+    for (const QString &space : report.colorspaces) {
+        if (space == "DeviceRGB" || space == "ICCBased RGB" || space == "CalRGB") {
+            problems << QObject::tr("Document uses %1.").arg(space);
+        }
+    }
+
+    if (!report.unembeddedFonts.isEmpty()) {
+        problems << QObject::tr("Fonts not embedded: %1.").arg(report.unembeddedFonts.join(", "));
+    }
+    return problems;
+}
@@ -0,0 +1,48 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFPREFLIGHT_H
+#define CYANPDFPREFLIGHT_H
+
+#include <QString>
+#include <QStringList>
+
+class CyanPDFPreflight
+{
+public:
+    struct Report
+    {
+        bool valid = false;
+        bool encrypted = false;
+        QString version;
+        QString pdfx;
+        int objects = 0;
+        int pages = 0;
+        int images = 0;
+        int iccProfiles = 0;
+        int undecodedStreams = 0;
+        QStringList colorspaces;
+        QStringList colorProfiles;
+        QStringList outputIntents;
+        QStringList outputProfiles;
+        QStringList unembeddedFonts;
+    };
+
+    static const Report getReport(const QString &filename);
+    static const Report scan(const QString &filename);
+    static const bool isCompliant(const Report &report,
+                                  const QString &outputIcc,
+                                  const QString &defGrayIcc,
+                                  const QString &defCmykIcc,
+                                  const int &renderIntent,
+                                  const bool &blackPoint,
+                                  const bool &overrideIcc,
+                                  const int &preset,
+                                  QString *reason = nullptr);
+    static const QStringList verify(const QString &filename,
+                                    const QString &outputIcc);
+};
+
+#endif // CYANPDFPREFLIGHT_H
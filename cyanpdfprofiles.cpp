@@ -0,0 +1,326 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfprofiles.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QStandardPaths>
+#include <QPair>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <lcms2.h>
+
+#define CYANPDF_PROFILES_FORMAT 1
+
+static QMutex profilesMutex;
+static QHash<QString, CyanPDFProfiles::Profile> profilesIndex;
+static bool profilesLoaded = false;
+static bool profilesDirty = false;
+
+static const QString readProfileId(cmsHPROFILE hprofile)
+{
+    cmsUInt8Number id[16] = {};
+    cmsGetHeaderProfileID(hprofile, id);
+    if (QByteArray(reinterpret_cast<const char*>(id), 16).count('\0') == 16) {
+        if (cmsMD5computeID(hprofile)) { cmsGetHeaderProfileID(hprofile, id); }
+    }
+    const QString result = QByteArray(reinterpret_cast<const char*>(id), 16).toHex();
+    return result == QString(32, QChar('0')) ? QString() : result;
+}
+
+const QStringList CyanPDFProfiles::getFolders()
+{
+    QStringList folders;
+#ifdef Q_OS_WIN
+    folders << QDir::rootPath() + "/WINDOWS/System32/spool/drivers/color";
+#elif defined(Q_OS_MAC)
+    folders << "/Library/ColorSync/Profiles";
+    folders << QDir::homePath() + "/Library/ColorSync/Profiles";
+#else
+    const QStringList common = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation);
+    for (const QString &path : common) { folders << QString("%1/color/icc").arg(path); }
+#endif
+    folders << QDir::homePath() + "/.color/icc";
+    return folders;
+}
+
+const CyanPDFProfiles::Profile CyanPDFProfiles::getProfile(const QString &filename)
+{
+    if (filename.isEmpty()) { return Profile(); }
+    return lookupProfile(QFileInfo(filename));
+}
+
+const QList<CyanPDFProfiles::Profile> CyanPDFProfiles::getProfiles()
+{
+    load();
+
+    const QStringList folders = getFolders();
+    QMutex mutex;
+    QList<QPair<int, Profile>> found;
+    QThreadPool pool;
+    for (int rank = 0; rank < folders.count(); ++rank) {
+        const QString folder = folders.at(rank);
+        pool.start([&pool, &mutex, &found, folder, rank]() {
+            const QStringList files = findFiles(folder);
+            for (const QString &file : files) {
+                pool.start([&mutex, &found, file, rank]() {
+                    const Profile profile = lookupProfile(QFileInfo(file));
+                    if (!profile.isValid()) { return; }
+                    QMutexLocker lock(&mutex);
+                    found.append({rank, profile});
+                });
+            }
+        });
+    }
+    pool.waitForDone();
+
+    std::sort(found.begin(), found.end(), [](const QPair<int, Profile> &a, const QPair<int, Profile> &b) {
+        return a.first != b.first ? a.first < b.first : a.second.path < b.second.path;
+    });
+
+    QList<Profile> profiles;
+    QSet<QString> ids;
+    for (const auto &entry : std::as_const(found)) {
+        if (ids.contains(entry.second.id)) { continue; }
+        ids.insert(entry.second.id);
+        profiles << entry.second;
+    }
+
+    prune();
+    save();
+    return profiles;
+}
+
+void CyanPDFProfiles::discover(QThreadPool *pool,
+                               QObject *receiver,
+                               const std::function<void(const Profile &, int)> &found,
+                               const std::function<void()> &finished)
+{
+    load();
+
+    const QStringList folders = getFolders();
+    const auto pending = std::make_shared<std::atomic<int>>(folders.count() + 1);
+    const auto complete = [pending, receiver, finished]() {
+        if (pending->fetch_sub(1) != 1) { return; }
+        prune();
+        save();
+        QMetaObject::invokeMethod(receiver, finished, Qt::QueuedConnection);
+    };
+
+    for (int rank = 0; rank < folders.count(); ++rank) {
+        const QString folder = folders.at(rank);
+        pool->start([pool, pending, receiver, found, complete, folder, rank]() {
+            const QStringList files = findFiles(folder);
+            pending->fetch_add(files.count());
+            for (const QString &file : files) {
+                pool->start([receiver, found, complete, file, rank]() {
+                    const Profile profile = lookupProfile(QFileInfo(file));
+                    if (profile.isValid()) {
+                        QMetaObject::invokeMethod(receiver, [found, profile, rank]() {
+                            found(profile, rank);
+                        }, Qt::QueuedConnection);
+                    }
+                    complete();
+                });
+            }
+            complete();
+        });
+    }
+    complete();
+}
+
+const QString CyanPDFProfiles::getProfileId(const QByteArray &data)
+{
+    if (data.isEmpty()) { return QString(); }
+    auto hprofile = cmsOpenProfileFromMem(data.constData(), cmsUInt32Number(data.size()));
+    if (!hprofile) { return QString(); }
+    const QString id = readProfileId(hprofile);
+    cmsCloseProfile(hprofile);
+    return id;
+}
+
+const bool CyanPDFProfiles::isUsable(const Profile &profile)
+{
+    if (!profile.isValid()) { return false; }
+    switch (profile.deviceClass) {
+    case cmsSigInputClass:
+    case cmsSigDisplayClass:
+    case cmsSigOutputClass:
+    case cmsSigColorSpaceClass:
+        return true;
+    default:;
+    }
+    return false;
+}
+
+void CyanPDFProfiles::load()
+{
+    QMutexLocker lock(&profilesMutex);
+    if (profilesLoaded) { return; }
+    profilesLoaded = true;
+
+    QFile file(QString("%1/profiles.json").arg(CyanPDFCore::getCachePath()));
+    if (!file.open(QIODevice::ReadOnly)) { return; }
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    file.close();
+    if (root.value("format").toInt() != CYANPDF_PROFILES_FORMAT) { return; }
+
+    const QJsonArray entries = root.value("profiles").toArray();
+    for (const auto &value : entries) {
+        const QJsonObject entry = value.toObject();
+        Profile profile;
+        profile.path = entry.value("path").toString();
+        profile.modified = entry.value("modified").toInteger();
+        profile.size = entry.value("size").toInteger();
+        profile.colorspace = entry.value("colorspace").toInt(CyanPDFCore::ColorSpace::NA);
+        profile.deviceClass = quint32(entry.value("class").toInteger());
+        profile.description = entry.value("description").toString();
+        profile.id = entry.value("id").toString();
+        if (!profile.path.isEmpty()) { profilesIndex.insert(profile.path, profile); }
+    }
+}
+
+void CyanPDFProfiles::prune()
+{
+    QMutexLocker lock(&profilesMutex);
+    for (auto it = profilesIndex.begin(); it != profilesIndex.end();) {
+        if (!QFile::exists(it.key())) {
+            it = profilesIndex.erase(it);
+            profilesDirty = true;
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CyanPDFProfiles::save()
+{
+    QMutexLocker lock(&profilesMutex);
+    if (!profilesDirty) { return; }
+
+    QJsonArray entries;
+    for (const Profile &profile : std::as_const(profilesIndex)) {
+        QJsonObject entry;
+        entry.insert("path", profile.path);
+        entry.insert("modified", profile.modified);
+        entry.insert("size", profile.size);
+        entry.insert("colorspace", profile.colorspace);
+        entry.insert("class", qint64(profile.deviceClass));
+        entry.insert("description", profile.description);
+        entry.insert("id", profile.id);
+        entries.append(entry);
+    }
+    QJsonObject root;
+    root.insert("format", CYANPDF_PROFILES_FORMAT);
+    root.insert("profiles", entries);
+
+    const QString path = QString("%1/profiles.json").arg(CyanPDFCore::getCachePath());
+    QFile file(path + ".part");
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        file.close();
+        QFile::remove(path);
+        if (QFile::rename(path + ".part", path)) { profilesDirty = false; }
+    }
+}
+
+const QStringList CyanPDFProfiles::findFiles(const QString &folder)
+{
+    QStringList files;
+    QDir directory(folder);
+    if (!directory.exists()) { return files; }
+    QDirIterator it(directory.absolutePath(),
+                    {"*.icc"},
+                    QDir::Files | QDir::Readable,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) { files << it.next(); }
+    return files;
+}
+
+const CyanPDFProfiles::Profile CyanPDFProfiles::lookupProfile(const QFileInfo &info)
+{
+    load();
+    if (!info.exists()) { return Profile(); }
+
+    const QString path = info.absoluteFilePath();
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    const qint64 size = info.size();
+    {
+        QMutexLocker lock(&profilesMutex);
+        const auto it = profilesIndex.constFind(path);
+        if (it != profilesIndex.constEnd() &&
+            it->modified == modified &&
+            it->size == size) { return it.value(); }
+    }
+
+    const Profile profile = readProfile(info);
+    QMutexLocker lock(&profilesMutex);
+    profilesIndex.insert(path, profile);
+    profilesDirty = true;
+    return profile;
+}
+
+const CyanPDFProfiles::Profile CyanPDFProfiles::readProfile(const QFileInfo &info)
+{
+    Profile profile;
+    profile.path = info.absoluteFilePath();
+    profile.modified = info.lastModified().toMSecsSinceEpoch();
+    profile.size = info.size();
+    if (!info.exists() || !CyanPDFCore::isICC(profile.path)) { return profile; }
+
+    auto hprofile = cmsOpenProfileFromFile(profile.path.toStdString().c_str(), "r");
+    if (!hprofile) { return profile; }
+
+    switch (cmsGetColorSpace(hprofile)) {
+    case cmsSigRgbData:
+        profile.colorspace = CyanPDFCore::ColorSpace::RGB;
+        break;
+    case cmsSigCmykData:
+        profile.colorspace = CyanPDFCore::ColorSpace::CMYK;
+        break;
+    case cmsSigGrayData:
+        profile.colorspace = CyanPDFCore::ColorSpace::GRAY;
+        break;
+    default:;
+    }
+    profile.deviceClass = cmsGetDeviceClass(hprofile);
+
+    cmsUInt32Number size = cmsGetProfileInfoASCII(hprofile,
+                                                  cmsInfoDescription,
+                                                  "en",
+                                                  "US",
+                                                  nullptr,
+                                                  0);
+    if (size > 0) {
+        std::vector<char> buffer(size);
+        cmsUInt32Number newsize = cmsGetProfileInfoASCII(hprofile,
+                                                         cmsInfoDescription,
+                                                         "en",
+                                                         "US",
+                                                         &buffer[0],
+                                                         size);
+        if (size == newsize) { profile.description = buffer.data(); }
+    }
+
+    profile.id = readProfileId(hprofile);
+
+    cmsCloseProfile(hprofile);
+    return profile;
+}
@@ -0,0 +1,55 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFPROFILES_H
+#define CYANPDFPROFILES_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QFileInfo>
+#include <QObject>
+#include <QThreadPool>
+
+#include <functional>
+
+#include "cyanpdfcore.h"
+
+class CyanPDFProfiles
+{
+public:
+    struct Profile
+    {
+        QString path;
+        qint64 modified = 0;
+        qint64 size = 0;
+        int colorspace = CyanPDFCore::ColorSpace::NA;
+        quint32 deviceClass = 0;
+        QString description;
+        QString id;
+        bool isValid() const { return !path.isEmpty() && !id.isEmpty(); }
+    };
+
+    static const QStringList getFolders();
+    static const Profile getProfile(const QString &filename);
+    static const QList<Profile> getProfiles();
+    static const QString getProfileId(const QByteArray &data);
+    static void discover(QThreadPool *pool,
+                         QObject *receiver,
+                         const std::function<void(const Profile &profile, int rank)> &found,
+                         const std::function<void()> &finished);
+    static const bool isUsable(const Profile &profile);
+
+    static void load();
+    static void save();
+    static void prune();
+
+private:
+    static const QStringList findFiles(const QString &folder);
+    static const Profile lookupProfile(const QFileInfo &info);
+    static const Profile readProfile(const QFileInfo &info);
+};
+
+#endif // CYANPDFPROFILES_H
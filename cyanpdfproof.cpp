@@ -0,0 +1,54 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfproof.h"
+#include "cyanpdfcore.h"
+#include "cyanpdftransforms.h"
+
+#include <QtConcurrent>
+
+#define CYANPDF_PROOF_TILE 64
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+#define CYANPDF_PROOF_TYPE TYPE_BGRA_8
+#else
+#define CYANPDF_PROOF_TYPE TYPE_ARGB_8
+#endif
+
+const QImage CyanPDFProof::getProof(const QImage &image,
+                                    const QString &outputIcc,
+                                    const int &renderIntent,
+                                    const bool &blackPoint,
+                                    const bool &gamutCheck)
+{
+    if (image.isNull() || !CyanPDFCore::isICC(outputIcc)) { return image; }
+
+    const CyanPDFTransforms::Transform transform = CyanPDFTransforms::getProofTransform(outputIcc,
+                                                                                        CYANPDF_PROOF_TYPE,
+                                                                                        renderIntent,
+                                                                                        blackPoint,
+                                                                                        gamutCheck);
+    if (!transform) { return image; }
+
+    const QImage input = image.convertToFormat(QImage::Format_RGB32);
+    QImage output(input.size(), QImage::Format_RGB32);
+    output.setDevicePixelRatio(image.devicePixelRatio());
+
+    const uchar *src = input.constBits();
+    uchar *dst = output.bits();
+    QList<int> tiles;
+    for (int y = 0; y < input.height(); y += CYANPDF_PROOF_TILE) { tiles << y; }
+    QtConcurrent::blockingMap(tiles, [&input, &output, src, dst, &transform](const int &top) {
+        const int bottom = qMin(top + CYANPDF_PROOF_TILE, input.height());
+        for (int y = top; y < bottom; ++y) {
+            cmsDoTransform(transform.get(),
+                           src + y * input.bytesPerLine(),
+                           dst + y * output.bytesPerLine(),
+                           cmsUInt32Number(input.width()));
+        }
+    });
+
+    return output;
+}
@@ -0,0 +1,22 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFPROOF_H
+#define CYANPDFPROOF_H
+
+#include <QImage>
+#include <QString>
+
+class CyanPDFProof
+{
+public:
+    static const QImage getProof(const QImage &image,
+                                 const QString &outputIcc,
+                                 const int &renderIntent,
+                                 const bool &blackPoint = true,
+                                 const bool &gamutCheck = false);
+};
+
+#endif // CYANPDFPROOF_H
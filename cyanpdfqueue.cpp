@@ -0,0 +1,130 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfqueue.h"
+
+#include <QThread>
+#include <QFileInfo>
+
+#include <utility>
+
+CyanPDFQueue::CyanPDFQueue(QObject *parent)
+    : QObject(parent)
+    , mOrder(Order::FirstIn)
+    , mMaxJobs(QThread::idealThreadCount())
+    , mMaxPending(0)
+{
+}
+
+const qint64 CyanPDFQueue::getCost(const QString &filename,
+                                   int *pages)
+{
+    // Ghostscript time grows with both the content and the number of pages
+    const int count = CyanPDFJob::getPageCount(filename);
+    if (pages) { *pages = count; }
+    return QFileInfo(filename).size() + qint64(count) * CYANPDF_QUEUE_PAGE_COST;
+}
+
+void CyanPDFQueue::setOrder(Order order)
+{
+    mOrder = order;
+}
+
+CyanPDFQueue::Order CyanPDFQueue::order() const
+{
+    return mOrder;
+}
+
+void CyanPDFQueue::setMaxJobs(int jobs)
+{
+    mMaxJobs = jobs > 0 ? jobs : QThread::idealThreadCount();
+    next();
+}
+
+int CyanPDFQueue::maxJobs() const
+{
+    return mMaxJobs;
+}
+
+void CyanPDFQueue::setMaxPending(int pending)
+{
+    mMaxPending = pending > 0 ? pending : 0;
+}
+
+int CyanPDFQueue::maxPending() const
+{
+    return mMaxPending;
+}
+
+int CyanPDFQueue::pendingCount() const
+{
+    return mPending.count();
+}
+
+int CyanPDFQueue::runningCount() const
+{
+    return mRunning.count();
+}
+
+bool CyanPDFQueue::isIdle() const
+{
+    return mPending.isEmpty() && mRunning.isEmpty();
+}
+
+bool CyanPDFQueue::isFull() const
+{
+    return mMaxPending > 0 && mPending.count() >= mMaxPending;
+}
+
+bool CyanPDFQueue::enqueue(const CyanPDFJob::Settings &settings,
+                           const qint64 &cost)
+{
+    if (isFull()) { return false; }
+    mPending.append({settings, cost});
+    next();
+    return true;
+}
+
+bool CyanPDFQueue::cancel(const QString &id)
+{
+    if (id.isEmpty()) { return false; }
+    for (const auto job : std::as_const(mRunning)) {
+        if (job->settings().id != id) { continue; }
+        job->cancel();
+        return true;
+    }
+    for (int i = 0; i < mPending.count(); ++i) {
+        if (mPending.at(i).settings.id != id) { continue; }
+        const CyanPDFJob::Settings settings = mPending.takeAt(i).settings;
+        emit pendingCanceled(settings);
+        if (isIdle()) { emit idle(); }
+        return true;
+    }
+    return false;
+}
+
+void CyanPDFQueue::next()
+{
+    while (mRunning.count() < mMaxJobs && !mPending.isEmpty()) {
+        qsizetype index = 0;
+        if (mOrder == Order::ShortestFirst) {
+            for (qsizetype i = 1; i < mPending.count(); ++i) {
+                if (mPending.at(i).cost < mPending.at(index).cost) { index = i; }
+            }
+        }
+        const auto job = new CyanPDFJob(mPending.takeAt(index).settings, this);
+        mRunning << job;
+        connect(job, &CyanPDFJob::finished,
+                this, [this, job](bool success, const QString &error) {
+            mRunning.removeAll(job);
+            emit jobFinished(job, success, error);
+            job->deleteLater();
+            next();
+            if (isIdle()) { emit idle(); }
+        });
+        emit jobStarted(job);
+        job->start();
+    }
+}
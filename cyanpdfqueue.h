@@ -0,0 +1,73 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFQUEUE_H
+#define CYANPDFQUEUE_H
+
+#include <QObject>
+#include <QList>
+
+#include "cyanpdfjob.h"
+
+#define CYANPDF_QUEUE_PAGE_COST (256 * 1024)
+
+class CyanPDFQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Order {
+        FirstIn,
+        ShortestFirst
+    };
+
+    explicit CyanPDFQueue(QObject *parent = nullptr);
+
+    static const qint64 getCost(const QString &filename,
+                                int *pages = nullptr);
+
+    void setOrder(Order order);
+    Order order() const;
+
+    void setMaxJobs(int jobs);
+    int maxJobs() const;
+
+    void setMaxPending(int pending);
+    int maxPending() const;
+
+    int pendingCount() const;
+    int runningCount() const;
+    bool isIdle() const;
+    bool isFull() const;
+
+    bool enqueue(const CyanPDFJob::Settings &settings,
+                 const qint64 &cost = 0);
+    bool cancel(const QString &id);
+
+signals:
+    void jobStarted(CyanPDFJob *job);
+    void jobFinished(CyanPDFJob *job,
+                     bool success,
+                     const QString &error);
+    void pendingCanceled(const CyanPDFJob::Settings &settings);
+    void idle();
+
+private:
+    struct Pending
+    {
+        CyanPDFJob::Settings settings;
+        qint64 cost = 0;
+    };
+
+    void next();
+
+    QList<Pending> mPending;
+    QList<CyanPDFJob*> mRunning;
+    Order mOrder;
+    int mMaxJobs;
+    int mMaxPending;
+};
+
+#endif // CYANPDFQUEUE_H
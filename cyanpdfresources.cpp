@@ -0,0 +1,110 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfresources.h"
+
+#include <QFile>
+#include <QThread>
+
+#include <atomic>
+
+#if defined(Q_OS_WIN)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(Q_OS_MAC)
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#endif
+
+static std::atomic<int> resourcesRunning {0};
+static std::atomic<int> resourcesMaxRuns {1};
+static std::atomic<qint64> resourcesMemoryLimit {0};
+
+void CyanPDFResources::setMaxRuns(const int &runs)
+{
+    resourcesMaxRuns = qMax(1, runs);
+}
+
+void CyanPDFResources::setMemoryLimit(const qint64 &bytes)
+{
+    resourcesMemoryLimit = bytes;
+}
+
+const qint64 CyanPDFResources::getAvailableMemory()
+{
+#if defined(Q_OS_WIN)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status)) { return qint64(status.ullAvailPhys); }
+#elif defined(Q_OS_MAC)
+    // no cheap equivalent of MemAvailable, assume half of the physical memory
+    quint64 memory = 0;
+    size_t length = sizeof(memory);
+    if (sysctlbyname("hw.memsize", &memory, &length, nullptr, 0) == 0) { return qint64(memory / 2); }
+#else
+    QFile file("/proc/meminfo");
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        while (!file.atEnd()) {
+            const QByteArray line = file.readLine();
+            if (!line.startsWith("MemAvailable:")) { continue; }
+            const QList<QByteArray> parts = line.simplified().split(' ');
+            if (parts.count() > 1) { return parts.at(1).toLongLong() * 1024; }
+        }
+    }
+#endif
+    return 0;
+}
+
+const CyanPDFResources::Limits CyanPDFResources::getLimits(const int &running)
+{
+    const qint64 mib = 1024 * 1024;
+    const int cores = qMax(1, QThread::idealThreadCount());
+    const int active = qMax(1, running);
+
+    // memory is shared by every run that may start, cores only by those that did
+    const int slots = qMax(active, resourcesMaxRuns.load());
+    qint64 available = getAvailableMemory();
+    if (available < 1) { available = 2048 * mib; }
+    const qint64 budget = qMax(CYANPDF_RESOURCES_MIN_MEMORY * mib, available * 3 / 4 / slots);
+
+    Limits limits;
+    limits.renderingThreads = qBound(1, cores / active, cores);
+    limits.maxBitmap = qBound(16 * mib, budget / 4, 1024 * mib);
+    limits.bufferSpace = qBound(4 * mib, budget / 16, 128 * mib);
+    limits.bandHeight = int(qBound<qint64>(32, limits.bufferSpace / CYANPDF_RESOURCES_ROW_BYTES, 1024));
+
+    // -K makes Ghostscript fail with VMerror instead of paging, so it is only used when asked for
+    limits.memoryLimit = resourcesMemoryLimit.load();
+    return limits;
+}
+
+const QStringList CyanPDFResources::getArgs(const Limits &limits)
+{
+    QStringList args;
+    if (limits.memoryLimit > 0) { args << QString("-K%1").arg(limits.memoryLimit / 1024); }
+    return args;
+}
+
+const QStringList CyanPDFResources::getRasterArgs(const Limits &limits)
+{
+    QStringList args;
+    args << QString("-dNumRenderingThreads=%1").arg(limits.renderingThreads)
+         << QString("-dBufferSpace=%1").arg(limits.bufferSpace)
+         << QString("-dMaxBitmap=%1").arg(limits.maxBitmap)
+         << QString("-dBandHeight=%1").arg(limits.bandHeight);
+    return args + getArgs(limits);
+}
+
+const int CyanPDFResources::acquire()
+{
+    return ++resourcesRunning;
+}
+
+void CyanPDFResources::release(const int &count)
+{
+    resourcesRunning -= count;
+}
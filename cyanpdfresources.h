@@ -0,0 +1,39 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFRESOURCES_H
+#define CYANPDFRESOURCES_H
+
+#include <QStringList>
+
+#define CYANPDF_RESOURCES_MIN_MEMORY 256
+#define CYANPDF_RESOURCES_ROW_BYTES (8192 * 4)
+
+class CyanPDFResources
+{
+public:
+    struct Limits
+    {
+        int renderingThreads = 1;
+        qint64 bufferSpace = 0;
+        qint64 maxBitmap = 0;
+        int bandHeight = 0;
+        qint64 memoryLimit = 0;
+    };
+
+    static void setMaxRuns(const int &runs);
+    static void setMemoryLimit(const qint64 &bytes);
+
+    static const qint64 getAvailableMemory();
+    static const Limits getLimits(const int &running);
+    // pdfwrite ignores the rendering and band settings, only raster devices get them
+    static const QStringList getArgs(const Limits &limits);
+    static const QStringList getRasterArgs(const Limits &limits);
+
+    static const int acquire();
+    static void release(const int &count = 1);
+};
+
+#endif // CYANPDFRESOURCES_H
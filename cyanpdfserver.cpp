@@ -0,0 +1,236 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfserver.h"
+#include "cyanpdfprofiles.h"
+#include "cyanpdfghostscript.h"
+
+#include <QJsonDocument>
+#include <QFileInfo>
+#include <QTextStream>
+
+#define CYANPDF_SERVER_MAX_LINE (1024 * 1024)
+
+CyanPDFServer::CyanPDFServer(const CyanPDFJob::Settings &defaults,
+                             QObject *parent)
+    : QObject(parent)
+    , mDefaults(defaults)
+    , mServer(nullptr)
+    , mQueue(nullptr)
+    , mSerial(0)
+{
+    mServer = new QLocalServer(this);
+    // requests name arbitrary files and Ghostscript runs with -dNOSAFER
+    mServer->setSocketOptions(QLocalServer::UserAccessOption);
+    mQueue = new CyanPDFQueue(this);
+
+    connect(mServer, &QLocalServer::newConnection,
+            this, &CyanPDFServer::handleConnection);
+    connect(mQueue, &CyanPDFQueue::jobStarted,
+            this, [this](CyanPDFJob *job) {
+        const QString id = job->settings().id;
+        send(id, {{"event", "started"}});
+        connect(job, &CyanPDFJob::progress,
+                this, [this, id](int page, int pages) {
+            send(id, {{"event", "progress"}, {"page", page}, {"pages", pages}});
+        });
+    });
+    connect(mQueue, &CyanPDFQueue::jobFinished,
+            this, &CyanPDFServer::handleFinished);
+    connect(mQueue, &CyanPDFQueue::pendingCanceled,
+            this, [this](const CyanPDFJob::Settings &settings) {
+        send(settings.id, {{"event", "finished"},
+                           {"success", false},
+                           {"canceled", true},
+                           {"error", tr("Conversion canceled.")}});
+        mRequests.remove(settings.id);
+    });
+}
+
+void CyanPDFServer::setMaxJobs(int jobs)
+{
+    mQueue->setMaxJobs(jobs);
+}
+
+bool CyanPDFServer::listen(const QString &name,
+                           QString *message)
+{
+    if (!mServer->listen(name)) {
+        // only remove the socket if nobody answers, it may belong to a running server
+        QLocalSocket probe;
+        probe.connectToServer(name);
+        if (probe.waitForConnected(1000)) {
+            probe.disconnectFromServer();
+            if (message) { *message = tr("Already running on %1.").arg(name); }
+            return false;
+        }
+        // a previous instance that crashed may have left the socket behind
+        QLocalServer::removeServer(name);
+        if (!mServer->listen(name)) {
+            if (message) { *message = mServer->errorString(); }
+            return false;
+        }
+    }
+
+    // warm up everything a job needs before the first request arrives
+    CyanPDFProfiles::getProfiles();
+    CyanPDFCore::getGhostscriptVersion();
+    if (mDefaults.useLibrary) { CyanPDFGhostscript::isAvailable(); }
+
+    QTextStream out(stdout);
+    out << tr("Listening on %1 (%2 jobs)").arg(mServer->fullServerName()).arg(mQueue->maxJobs()) << Qt::endl;
+    return true;
+}
+
+void CyanPDFServer::handleConnection()
+{
+    while (mServer->hasPendingConnections()) {
+        const auto socket = mServer->nextPendingConnection();
+        connect(socket, &QLocalSocket::readyRead,
+                this, [this, socket]() { handleReadyRead(socket); });
+        connect(socket, &QLocalSocket::disconnected,
+                this, [this, socket]() {
+            mBuffers.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void CyanPDFServer::handleReadyRead(QLocalSocket *socket)
+{
+    QByteArray &buffer = mBuffers[socket];
+    buffer.append(socket->readAll());
+
+    qsizetype pos;
+    while ((pos = buffer.indexOf('\n')) >= 0) {
+        const QByteArray line = buffer.left(pos).trimmed();
+        buffer.remove(0, pos + 1);
+        if (line.isEmpty()) { continue; }
+
+        QJsonParseError error;
+        const QJsonDocument doc = QJsonDocument::fromJson(line, &error);
+        if (!doc.isObject()) {
+            send(socket, {{"event", "error"},
+                          {"error", error.error != QJsonParseError::NoError ? error.errorString() : tr("Expected a JSON object.")}});
+            continue;
+        }
+        handleRequest(socket, doc.object());
+    }
+    if (buffer.size() > CYANPDF_SERVER_MAX_LINE) {
+        send(socket, {{"event", "error"}, {"error", tr("Request too large.")}});
+        socket->disconnectFromServer();
+    }
+}
+
+void CyanPDFServer::handleRequest(QLocalSocket *socket,
+                                  const QJsonObject &request)
+{
+    const QString command = request.value("command").toString("convert");
+    const QJsonValue clientId = request.value("id");
+
+    if (command == "status") {
+        send(socket, {{"event", "status"},
+                      {"id", clientId},
+                      {"pending", mQueue->pendingCount()},
+                      {"running", mQueue->runningCount()},
+                      {"jobs", mQueue->maxJobs()}});
+        return;
+    }
+
+    if (command == "cancel") {
+        for (auto it = mRequests.constBegin(); it != mRequests.constEnd(); ++it) {
+            if (it->socket != socket || it->id != clientId) { continue; }
+            mQueue->cancel(it.key());
+            return;
+        }
+        send(socket, {{"event", "error"}, {"id", clientId}, {"error", tr("No such job.")}});
+        return;
+    }
+
+    if (command != "convert") {
+        send(socket, {{"event", "error"}, {"id", clientId}, {"error", tr("Unknown command %1.").arg(command)}});
+        return;
+    }
+
+    CyanPDFJob::Settings settings = getSettings(request);
+    if (settings.inputFile.isEmpty() || settings.outputFile.isEmpty()) {
+        send(socket, {{"event", "error"}, {"id", clientId}, {"error", tr("Missing input or output.")}});
+        return;
+    }
+    if (settings.renderIntent < CyanPDFCore::RenderIntent::Perceptual ||
+        settings.renderIntent > CyanPDFCore::RenderIntent::AbsoluteColorimetric) {
+        send(socket, {{"event", "error"}, {"id", clientId}, {"error", tr("Invalid rendering intent.")}});
+        return;
+    }
+    if (settings.preset < 0) {
+        send(socket, {{"event", "error"}, {"id", clientId}, {"error", tr("Invalid preset.")}});
+        return;
+    }
+    settings.id = QString::number(++mSerial);
+    mRequests.insert(settings.id, {socket, clientId});
+    send(settings.id, {{"event", "queued"}, {"pending", mQueue->pendingCount()}});
+    mQueue->enqueue(settings);
+}
+
+void CyanPDFServer::handleFinished(CyanPDFJob *job,
+                                   bool success,
+                                   const QString &error)
+{
+    const QString id = job->settings().id;
+    send(id, {{"event", "finished"},
+              {"success", success},
+              {"canceled", job->isCanceled()},
+              {"cached", job->isCached()},
+              {"passedThrough", job->isPassedThrough()},
+              {"output", job->settings().outputFile},
+              {"elapsed", job->elapsed()},
+              {"size", success ? QFileInfo(job->settings().outputFile).size() : 0},
+              {"error", error},
+              {"log", success ? QString() : job->log()}});
+    mRequests.remove(id);
+}
+
+void CyanPDFServer::send(QLocalSocket *socket,
+                         const QJsonObject &message)
+{
+    if (!socket || socket->state() != QLocalSocket::ConnectedState) { return; }
+    socket->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n');
+    socket->flush();
+}
+
+void CyanPDFServer::send(const QString &id,
+                         QJsonObject message)
+{
+    const auto it = mRequests.constFind(id);
+    if (it == mRequests.constEnd()) { return; }
+    message.insert("id", it->id);
+    send(it->socket.data(), message);
+}
+
+const CyanPDFJob::Settings CyanPDFServer::getSettings(const QJsonObject &request) const
+{
+    const auto path = [&request](const char *key, const QString &fallback = QString()) {
+        const QString value = request.value(key).toString();
+        return value.isEmpty() ? fallback : QFileInfo(value).absoluteFilePath();
+    };
+
+    CyanPDFJob::Settings settings = mDefaults;
+    settings.inputFile = path("input");
+    settings.outputFile = path("output");
+    settings.outputIcc = path("outputIcc", mDefaults.outputIcc);
+    settings.defRgbIcc = path("rgbIcc", mDefaults.defRgbIcc);
+    settings.defCmykIcc = path("cmykIcc", mDefaults.defCmykIcc);
+    settings.defGrayIcc = path("grayIcc", mDefaults.defGrayIcc);
+    settings.renderIntent = request.value("intent").toInt(mDefaults.renderIntent);
+    settings.blackPoint = request.value("blackPoint").toBool(mDefaults.blackPoint);
+    settings.overrideIcc = request.value("overrideIcc").toBool(mDefaults.overrideIcc);
+    settings.preset = CyanPDFCore::getPreset(request.value("preset").toString(CyanPDFCore::getPresetName(mDefaults.preset)));
+    settings.shards = qMax(1, request.value("shards").toInt(mDefaults.shards));
+    settings.verifyShards = request.value("verifyShards").toBool(mDefaults.verifyShards);
+    settings.useCache = request.value("cache").toBool(mDefaults.useCache);
+    settings.passThrough = request.value("passThrough").toBool(mDefaults.passThrough);
+    settings.useLibrary = request.value("libgs").toBool(mDefaults.useLibrary);
+    return settings;
+}
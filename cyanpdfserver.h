@@ -0,0 +1,58 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFSERVER_H
+#define CYANPDFSERVER_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonObject>
+#include <QPointer>
+#include <QHash>
+
+#include "cyanpdfqueue.h"
+
+class CyanPDFServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CyanPDFServer(const CyanPDFJob::Settings &defaults,
+                           QObject *parent = nullptr);
+
+    void setMaxJobs(int jobs);
+    bool listen(const QString &name,
+                QString *message = nullptr);
+
+private:
+    struct Request
+    {
+        QPointer<QLocalSocket> socket;
+        QJsonValue id;
+    };
+
+    void handleConnection();
+    void handleReadyRead(QLocalSocket *socket);
+    void handleRequest(QLocalSocket *socket,
+                       const QJsonObject &request);
+    void handleFinished(CyanPDFJob *job,
+                        bool success,
+                        const QString &error);
+    void send(QLocalSocket *socket,
+              const QJsonObject &message);
+    void send(const QString &id,
+              QJsonObject message);
+    const CyanPDFJob::Settings getSettings(const QJsonObject &request) const;
+
+    CyanPDFJob::Settings mDefaults;
+    QLocalServer *mServer;
+    CyanPDFQueue *mQueue;
+    QHash<QString, Request> mRequests;
+    QHash<QLocalSocket*, QByteArray> mBuffers;
+    quint64 mSerial;
+};
+
+#endif // CYANPDFSERVER_H
@@ -0,0 +1,118 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdftrace.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <cstring>
+
+static QMutex traceMutex;
+static QFile traceFile;
+static QElapsedTimer traceTimer;
+static int traceThreads = 0;
+static thread_local int traceThread = -1;
+
+static void writeEvent(const QJsonObject &event)
+{
+    // the trailing ']' is optional in the trace event format, so a trace
+    // from a process that was killed can still be loaded
+    traceFile.write(QJsonDocument(event).toJson(QJsonDocument::Compact));
+    traceFile.write(",\n");
+    traceFile.flush();
+}
+
+const QString CyanPDFTrace::getFilename(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) { return QString::fromLocal8Bit(argv[i + 1]); }
+        if (std::strncmp(argv[i], "--trace=", 8) == 0) { return QString::fromLocal8Bit(argv[i] + 8); }
+    }
+    return qEnvironmentVariable(CYANPDF_TRACE_ENV);
+}
+
+const bool CyanPDFTrace::start(const QString &filename)
+{
+    if (filename.isEmpty()) { return false; }
+    QMutexLocker lock(&traceMutex);
+    if (traceFile.isOpen()) { return true; }
+    traceFile.setFileName(filename);
+    if (!traceFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) { return false; }
+    traceFile.write("[\n");
+    traceThread = traceThreads++;
+    writeEvent(QJsonObject {
+        {"name", "process_name"},
+        {"ph", "M"},
+        {"pid", QCoreApplication::applicationPid()},
+        {"tid", traceThread},
+        {"args", QJsonObject {{"name", "cyanpdf"}}}
+    });
+    writeEvent(QJsonObject {
+        {"name", "thread_name"},
+        {"ph", "M"},
+        {"pid", QCoreApplication::applicationPid()},
+        {"tid", traceThread},
+        {"args", QJsonObject {{"name", "main"}}}
+    });
+    traceTimer.start();
+    mEnabled = true;
+    return true;
+}
+
+void CyanPDFTrace::stop()
+{
+    QMutexLocker lock(&traceMutex);
+    if (!traceFile.isOpen()) { return; }
+    mEnabled = false;
+    traceFile.seek(traceFile.size() - 2);
+    traceFile.write("\n]\n");
+    traceFile.close();
+}
+
+qint64 CyanPDFTrace::now()
+{
+    return traceTimer.nsecsElapsed();
+}
+
+void CyanPDFTrace::complete(const char *name,
+                            const qint64 &start,
+                            const QString &detail)
+{
+    if (!isEnabled() || start < 0) { return; }
+    const qint64 end = now();
+    QMutexLocker lock(&traceMutex);
+    if (!traceFile.isOpen()) { return; }
+
+    if (traceThread < 0) {
+        traceThread = traceThreads++;
+        const QString thread = QThread::currentThread()->objectName();
+        writeEvent(QJsonObject {
+            {"name", "thread_name"},
+            {"ph", "M"},
+            {"pid", QCoreApplication::applicationPid()},
+            {"tid", traceThread},
+            {"args", QJsonObject {{"name", thread.isEmpty() ? QString("thread %1").arg(traceThread) : thread}}}
+        });
+    }
+
+    QJsonObject event {
+        {"name", name},
+        {"cat", "cyanpdf"},
+        {"ph", "X"},
+        {"ts", double(start) / 1000.0},
+        {"dur", double(end - start) / 1000.0},
+        {"pid", QCoreApplication::applicationPid()},
+        {"tid", traceThread}
+    };
+    if (!detail.isEmpty()) { event["args"] = QJsonObject {{"detail", detail}}; }
+    writeEvent(event);
+}
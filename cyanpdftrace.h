@@ -0,0 +1,59 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFTRACE_H
+#define CYANPDFTRACE_H
+
+#include <QString>
+
+#include <atomic>
+
+#define CYANPDF_TRACE_ENV "CYANPDF_TRACE"
+
+class CyanPDFTrace
+{
+public:
+    class Span
+    {
+    public:
+        explicit Span(const char *name,
+                      const QString &detail = QString())
+            : mName(name)
+            , mStart(isEnabled() ? now() : -1)
+        {
+            if (mStart >= 0) { mDetail = detail; }
+        }
+        ~Span()
+        {
+            if (mStart >= 0) { complete(mName, mStart, mDetail); }
+        }
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+    private:
+        const char *mName;
+        qint64 mStart;
+        QString mDetail;
+    };
+
+    static bool isEnabled()
+    {
+        return mEnabled.load(std::memory_order_relaxed);
+    }
+
+    static const QString getFilename(int argc, char *argv[]);
+    static const bool start(const QString &filename);
+    static void stop();
+
+    static qint64 now();
+    static void complete(const char *name,
+                         const qint64 &start,
+                         const QString &detail = QString());
+
+private:
+    static inline std::atomic<bool> mEnabled {false};
+};
+
+#endif // CYANPDFTRACE_H
@@ -0,0 +1,259 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdftransforms.h"
+#include "cyanpdfprofiles.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QByteArray>
+#include <QCache>
+#include <QDateTime>
+#include <QStringList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QCryptographicHash>
+
+#define CYANPDF_TRANSFORMS_FORMAT 1
+#define CYANPDF_TRANSFORMS_DEFAULT_MAX 16
+#define CYANPDF_TRANSFORMS_ALPHA(in, out) (T_EXTRA(in) > 0 && T_EXTRA(in) == T_EXTRA(out) ? cmsFLAGS_COPY_ALPHA : 0)
+
+static QMutex transformsMutex;
+static QCache<QString, CyanPDFTransforms::Transform> transformsCache(CYANPDF_TRANSFORMS_DEFAULT_MAX);
+
+const QString CyanPDFTransforms::getLinksPath()
+{
+    const QString cache = CyanPDFCore::getCachePath();
+    if (cache.isEmpty()) { return QString(); }
+    const QString path = cache + "/links";
+    if (!QFile::exists(path)) {
+        QDir dir(path);
+        if (!dir.mkpath(path)) { return QString(); }
+    }
+    return path;
+}
+
+const CyanPDFTransforms::Transform CyanPDFTransforms::getTransform(const QString &inputIcc,
+                                                                   const QString &outputIcc,
+                                                                   const cmsUInt32Number &inputFormat,
+                                                                   const cmsUInt32Number &outputFormat,
+                                                                   const int &renderIntent,
+                                                                   const bool &blackPoint)
+{
+    return getTransform(inputIcc,
+                        outputIcc,
+                        QString(),
+                        inputFormat,
+                        outputFormat,
+                        renderIntent,
+                        blackPoint,
+                        false);
+}
+
+const CyanPDFTransforms::Transform CyanPDFTransforms::getProofTransform(const QString &proofIcc,
+                                                                        const cmsUInt32Number &format,
+                                                                        const int &renderIntent,
+                                                                        const bool &blackPoint,
+                                                                        const bool &gamutCheck)
+{
+    if (proofIcc.isEmpty()) { return Transform(); }
+    // the page renderer and the screen are both treated as sRGB
+    return getTransform(QString(),
+                        QString(),
+                        proofIcc,
+                        format,
+                        format,
+                        renderIntent,
+                        blackPoint,
+                        gamutCheck);
+}
+
+void CyanPDFTransforms::setMaxTransforms(const int &count)
+{
+    QMutexLocker lock(&transformsMutex);
+    transformsCache.setMaxCost(qMax(1, count));
+}
+
+void CyanPDFTransforms::clear()
+{
+    QMutexLocker lock(&transformsMutex);
+    transformsCache.clear();
+}
+
+const CyanPDFTransforms::Transform CyanPDFTransforms::getTransform(const QString &inputIcc,
+                                                                   const QString &outputIcc,
+                                                                   const QString &proofIcc,
+                                                                   const cmsUInt32Number &inputFormat,
+                                                                   const cmsUInt32Number &outputFormat,
+                                                                   const int &renderIntent,
+                                                                   const bool &blackPoint,
+                                                                   const bool &gamutCheck)
+{
+    const QString inputKey = getProfileKey(inputIcc);
+    const QString outputKey = getProfileKey(outputIcc);
+    const QString proofKey = proofIcc.isEmpty() ? QString() : getProfileKey(proofIcc);
+    if (inputKey.isEmpty() || outputKey.isEmpty()) { return Transform(); }
+    if (!proofIcc.isEmpty() && proofKey.isEmpty()) { return Transform(); }
+
+    const QString key = QCryptographicHash::hash(QStringList({
+        QString::number(CYANPDF_TRANSFORMS_FORMAT),
+        "transform",
+        inputKey,
+        outputKey,
+        proofKey,
+        QString::number(inputFormat, 16),
+        QString::number(outputFormat, 16),
+        QString::number(renderIntent),
+        blackPoint ? "bpc" : "nobpc",
+        gamutCheck ? "gamut" : "nogamut"
+    }).join('\n').toUtf8(), QCryptographicHash::Sha1).toHex();
+
+    Transform transform = lookup(key);
+    if (transform) { return transform; }
+
+    // the gamut alarm is not part of the pipeline, so only plain transforms can be linked
+    if (!gamutCheck) {
+        transform = loadLink(key, inputFormat, outputFormat, renderIntent);
+        if (transform) {
+            insert(key, transform);
+            return transform;
+        }
+    }
+
+    cmsHPROFILE input = openProfile(inputIcc);
+    cmsHPROFILE output = openProfile(outputIcc);
+    cmsHPROFILE proof = proofIcc.isEmpty() ? nullptr : openProfile(proofIcc);
+
+    cmsHTRANSFORM xform = nullptr;
+    if (input && output && (proofIcc.isEmpty() || proof)) {
+        cmsUInt32Number flags = CYANPDF_TRANSFORMS_ALPHA(inputFormat, outputFormat);
+        if (blackPoint) { flags |= cmsFLAGS_BLACKPOINTCOMPENSATION; }
+        if (proof) {
+            flags |= cmsFLAGS_SOFTPROOFING;
+            if (gamutCheck) { flags |= cmsFLAGS_GAMUTCHECK; }
+            // alarm codes are global and copied into the transform on creation
+            QMutexLocker lock(&transformsMutex);
+            cmsUInt16Number alarm[cmsMAXCHANNELS] = {0xffff, 0, 0xffff};
+            cmsSetAlarmCodes(alarm);
+            xform = cmsCreateProofingTransform(input,
+                                               inputFormat,
+                                               output,
+                                               outputFormat,
+                                               proof,
+                                               renderIntent,
+                                               INTENT_RELATIVE_COLORIMETRIC,
+                                               flags);
+        } else {
+            xform = cmsCreateTransform(input,
+                                       inputFormat,
+                                       output,
+                                       outputFormat,
+                                       renderIntent,
+                                       flags);
+        }
+    }
+    if (input) { cmsCloseProfile(input); }
+    if (output) { cmsCloseProfile(output); }
+    if (proof) { cmsCloseProfile(proof); }
+    if (!xform) { return Transform(); }
+
+    if (!gamutCheck) { saveLink(key, xform); }
+    transform = wrap(xform);
+    insert(key, transform);
+    return transform;
+}
+
+const QString CyanPDFTransforms::getProfileKey(const QString &filename)
+{
+    if (filename.isEmpty()) { return "srgb"; }
+    return CyanPDFProfiles::getProfile(filename).id;
+}
+
+cmsHPROFILE CyanPDFTransforms::openProfile(const QString &filename)
+{
+    if (filename.isEmpty()) { return cmsCreate_sRGBProfile(); }
+    return cmsOpenProfileFromFile(filename.toStdString().c_str(), "r");
+}
+
+const CyanPDFTransforms::Transform CyanPDFTransforms::lookup(const QString &key)
+{
+    QMutexLocker lock(&transformsMutex);
+    const Transform *transform = transformsCache.object(key);
+    return transform ? *transform : Transform();
+}
+
+void CyanPDFTransforms::insert(const QString &key,
+                               const Transform &transform)
+{
+    QMutexLocker lock(&transformsMutex);
+    transformsCache.insert(key, new Transform(transform));
+}
+
+const CyanPDFTransforms::Transform CyanPDFTransforms::loadLink(const QString &key,
+                                                               const cmsUInt32Number &inputFormat,
+                                                               const cmsUInt32Number &outputFormat,
+                                                               const int &renderIntent)
+{
+    const QString links = getLinksPath();
+    if (links.isEmpty()) { return Transform(); }
+    const QString path = QString("%1/%2.icc").arg(links, key);
+    if (!QFile::exists(path)) { return Transform(); }
+
+    cmsHPROFILE link = cmsOpenProfileFromFile(path.toStdString().c_str(), "r");
+    if (!link) {
+        QFile::remove(path);
+        return Transform();
+    }
+    cmsHTRANSFORM xform = cmsCreateTransform(link,
+                                             inputFormat,
+                                             nullptr,
+                                             outputFormat,
+                                             renderIntent,
+                                             CYANPDF_TRANSFORMS_ALPHA(inputFormat, outputFormat));
+    cmsCloseProfile(link);
+    if (!xform) {
+        QFile::remove(path);
+        return Transform();
+    }
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        file.close();
+    }
+    return wrap(xform);
+}
+
+void CyanPDFTransforms::saveLink(const QString &key,
+                                 cmsHTRANSFORM transform)
+{
+    const QString links = getLinksPath();
+    if (links.isEmpty()) { return; }
+    const QString path = QString("%1/%2.icc").arg(links, key);
+
+    cmsHPROFILE link = cmsTransform2DeviceLink(transform, 4.3, 0);
+    if (!link) { return; }
+    cmsUInt32Number size = 0;
+    QByteArray data;
+    if (cmsSaveProfileToMem(link, nullptr, &size) && size > 0) {
+        data.resize(qsizetype(size));
+        if (!cmsSaveProfileToMem(link, data.data(), &size)) { data.clear(); }
+    }
+    cmsCloseProfile(link);
+    if (data.isEmpty()) { return; }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) { return; }
+    if (file.write(data) != data.size()) {
+        file.cancelWriting();
+        return;
+    }
+    file.commit();
+}
+
+const CyanPDFTransforms::Transform CyanPDFTransforms::wrap(cmsHTRANSFORM transform)
+{
+    return Transform(transform, [](void *xform) { cmsDeleteTransform(xform); });
+}
@@ -0,0 +1,61 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFTRANSFORMS_H
+#define CYANPDFTRANSFORMS_H
+
+#include <QString>
+
+#include <memory>
+
+#include <lcms2.h>
+
+class CyanPDFTransforms
+{
+public:
+    typedef std::shared_ptr<void> Transform;
+
+    static const QString getLinksPath();
+
+    // empty profile paths means built-in sRGB
+    static const Transform getTransform(const QString &inputIcc,
+                                        const QString &outputIcc,
+                                        const cmsUInt32Number &inputFormat,
+                                        const cmsUInt32Number &outputFormat,
+                                        const int &renderIntent,
+                                        const bool &blackPoint = true);
+    static const Transform getProofTransform(const QString &proofIcc,
+                                             const cmsUInt32Number &format,
+                                             const int &renderIntent,
+                                             const bool &blackPoint = true,
+                                             const bool &gamutCheck = false);
+
+    static void setMaxTransforms(const int &count);
+    static void clear();
+
+private:
+    static const Transform getTransform(const QString &inputIcc,
+                                        const QString &outputIcc,
+                                        const QString &proofIcc,
+                                        const cmsUInt32Number &inputFormat,
+                                        const cmsUInt32Number &outputFormat,
+                                        const int &renderIntent,
+                                        const bool &blackPoint,
+                                        const bool &gamutCheck);
+    static const QString getProfileKey(const QString &filename);
+    static cmsHPROFILE openProfile(const QString &filename);
+    static const Transform lookup(const QString &key);
+    static void insert(const QString &key,
+                       const Transform &transform);
+    static const Transform loadLink(const QString &key,
+                                    const cmsUInt32Number &inputFormat,
+                                    const cmsUInt32Number &outputFormat,
+                                    const int &renderIntent);
+    static void saveLink(const QString &key,
+                         cmsHTRANSFORM transform);
+    static const Transform wrap(cmsHTRANSFORM transform);
+};
+
+#endif // CYANPDFTRANSFORMS_H
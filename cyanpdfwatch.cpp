@@ -0,0 +1,190 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#include "cyanpdfwatch.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QTextStream>
+
+#define CYANPDF_WATCH_SETTLE 2000
+
+CyanPDFWatch::CyanPDFWatch(const CyanPDFJob::Settings &defaults,
+                           QObject *parent)
+    : QObject(parent)
+    , mDefaults(defaults)
+    , mQueue(nullptr)
+    , mWatcher(nullptr)
+    , mTimer(nullptr)
+    , mSettle(CYANPDF_WATCH_SETTLE)
+{
+    mQueue = new CyanPDFQueue(this);
+    mWatcher = new QFileSystemWatcher(this);
+    mTimer = new QTimer(this);
+
+    connect(mQueue, &CyanPDFQueue::jobFinished,
+            this, &CyanPDFWatch::handleFinished);
+    connect(mWatcher, &QFileSystemWatcher::directoryChanged,
+            this, &CyanPDFWatch::scan);
+    // polling also covers network shares where change notifications are unreliable
+    connect(mTimer, &QTimer::timeout,
+            this, &CyanPDFWatch::scan);
+}
+
+void CyanPDFWatch::setMaxJobs(int jobs)
+{
+    mQueue->setMaxJobs(jobs);
+}
+
+void CyanPDFWatch::setMaxPending(int pending)
+{
+    mQueue->setMaxPending(pending);
+}
+
+void CyanPDFWatch::setSettleTime(int msec)
+{
+    mSettle = qMax(0, msec);
+}
+
+bool CyanPDFWatch::start(const QString &input,
+                         const QString &output,
+                         const QString &done,
+                         const QString &error,
+                         QString *message)
+{
+    mInput = QFileInfo(input).absoluteFilePath();
+    mOutput = QFileInfo(output).absoluteFilePath();
+    mDone = QFileInfo(done.isEmpty() ? mInput + "/done" : done).absoluteFilePath();
+    mError = QFileInfo(error.isEmpty() ? mInput + "/error" : error).absoluteFilePath();
+
+    if (!QFileInfo(mInput).isDir()) {
+        if (message) { *message = tr("Watch folder %1 does not exist.").arg(mInput); }
+        return false;
+    }
+    for (const QString &folder : {mOutput, mDone, mError}) {
+        if (!QDir().mkpath(folder)) {
+            if (message) { *message = tr("Unable to create folder %1.").arg(folder); }
+            return false;
+        }
+    }
+    if (mOutput == mInput) {
+        if (message) { *message = tr("Watch and output folder must be different."); }
+        return false;
+    }
+
+    mWatcher->addPath(mInput);
+    mTimer->start(qBound(250, mSettle / 2, 5000));
+
+    QTextStream out(stdout);
+    out << tr("Watching %1 (%2 jobs, %3 pending)").arg(mInput)
+                                                 .arg(mQueue->maxJobs())
+                                                 .arg(mQueue->maxPending()) << Qt::endl;
+    scan();
+    return true;
+}
+
+void CyanPDFWatch::scan()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const auto files = QDir(mInput).entryInfoList({"*.pdf", "*.PDF"}, QDir::Files | QDir::Readable, QDir::Time | QDir::Reversed);
+
+    QSet<QString> seen;
+    for (const QFileInfo &info : files) {
+        const QString path = info.absoluteFilePath();
+        seen.insert(path);
+        if (mActive.contains(path)) { continue; }
+
+        const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+        if (mIgnored.contains(path)) {
+            if (mIgnored.value(path) == modified) { continue; }
+            mIgnored.remove(path);
+        }
+
+        // a file is picked up once its size and mtime stop changing
+        Candidate &candidate = mCandidates[path];
+        if (candidate.size != info.size() || candidate.modified != modified) {
+            candidate.size = info.size();
+            candidate.modified = modified;
+            candidate.changed = now;
+            continue;
+        }
+        if (candidate.size < 1 || now - candidate.changed < mSettle) { continue; }
+        // settled files stay on disk until the queue has room, the next scan picks them up
+        if (mQueue->isFull()) { continue; }
+        mCandidates.remove(path);
+        enqueue(path);
+    }
+
+    for (auto it = mCandidates.begin(); it != mCandidates.end();) {
+        if (seen.contains(it.key())) { ++it; }
+        else { it = mCandidates.erase(it); }
+    }
+    for (auto it = mIgnored.begin(); it != mIgnored.end();) {
+        if (seen.contains(it.key())) { ++it; }
+        else { it = mIgnored.erase(it); }
+    }
+}
+
+void CyanPDFWatch::enqueue(const QString &path)
+{
+    CyanPDFJob::Settings settings = mDefaults;
+    settings.inputFile = path;
+    settings.outputFile = QDir(mOutput).absoluteFilePath(QFileInfo(path).completeBaseName() + ".pdf");
+    mActive.insert(path);
+    mQueue->enqueue(settings);
+}
+
+void CyanPDFWatch::handleFinished(CyanPDFJob *job,
+                                  bool success,
+                                  const QString &error)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    const auto &settings = job->settings();
+    const QString seconds = QString::number(job->elapsed() / 1000.0, 'f', 2);
+    const QString timestamp = QDateTime::currentDateTime().toString(Qt::ISODate);
+    mActive.remove(settings.inputFile);
+
+    if (success) {
+        out << QString("%1 OK %2 -> %3 (%4s%5)").arg(timestamp,
+                                                     settings.inputFile,
+                                                     settings.outputFile,
+                                                     seconds,
+                                                     job->isCached() ? ", cached" :
+                                                     job->isPassedThrough() ? ", passed through" : "") << Qt::endl;
+        if (moveFile(settings.inputFile, mDone).isEmpty()) {
+            err << tr("Unable to move %1 to %2.").arg(settings.inputFile, mDone) << Qt::endl;
+        }
+    } else {
+        err << QString("%1 FAILED %2: %3 (%4s)").arg(timestamp, settings.inputFile, error, seconds) << Qt::endl;
+        const QString moved = moveFile(settings.inputFile, mError);
+        if (moved.isEmpty()) {
+            err << tr("Unable to move %1 to %2.").arg(settings.inputFile, mError) << Qt::endl;
+        } else {
+            QFile log(QString("%1/%2.log").arg(mError, QFileInfo(moved).completeBaseName()));
+            if (log.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+                QTextStream stream(&log);
+                stream << error << Qt::endl << Qt::endl << job->log();
+                log.close();
+            }
+        }
+    }
+    // files that could not be moved are skipped until they change
+    const QFileInfo info(settings.inputFile);
+    if (info.exists()) { mIgnored.insert(settings.inputFile, info.lastModified().toMSecsSinceEpoch()); }
+    scan();
+}
+
+const QString CyanPDFWatch::moveFile(const QString &filename,
+                                     const QString &folder)
+{
+    const QString target = QDir(folder).absoluteFilePath(QFileInfo(filename).fileName());
+    QFile::remove(target);
+    if (QFile::rename(filename, target)) { return target; }
+    if (QFile::copy(filename, target) && QFile::remove(filename)) { return target; }
+    return QString();
+}
@@ -0,0 +1,65 @@
+/*
+# SPDX-License-Identifier: AGPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 Ole-André Rodlie <https://pdf.cyan.graphics>
+*/
+
+#ifndef CYANPDFWATCH_H
+#define CYANPDFWATCH_H
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QHash>
+#include <QSet>
+
+#include "cyanpdfqueue.h"
+
+class CyanPDFWatch : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CyanPDFWatch(const CyanPDFJob::Settings &defaults,
+                          QObject *parent = nullptr);
+
+    void setMaxJobs(int jobs);
+    void setMaxPending(int pending);
+    void setSettleTime(int msec);
+
+    bool start(const QString &input,
+               const QString &output,
+               const QString &done,
+               const QString &error,
+               QString *message = nullptr);
+
+private:
+    struct Candidate
+    {
+        qint64 size = -1;
+        qint64 modified = -1;
+        qint64 changed = 0;
+    };
+
+    void scan();
+    void enqueue(const QString &path);
+    void handleFinished(CyanPDFJob *job,
+                        bool success,
+                        const QString &error);
+    static const QString moveFile(const QString &filename,
+                                  const QString &folder);
+
+    CyanPDFJob::Settings mDefaults;
+    CyanPDFQueue *mQueue;
+    QFileSystemWatcher *mWatcher;
+    QTimer *mTimer;
+    QString mInput;
+    QString mOutput;
+    QString mDone;
+    QString mError;
+    int mSettle;
+    QHash<QString, Candidate> mCandidates;
+    QSet<QString> mActive;
+    QHash<QString, qint64> mIgnored;
+};
+
+#endif // CYANPDFWATCH_H
@@ -4,19 +4,34 @@
 */
 
 #include "cyanpdf.h"
+#include "cyanpdfbatch.h"
+#include "cyanpdftrace.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    QCoreApplication::setApplicationName("cyanpdf");
+    QCoreApplication::setOrganizationName("cyanpdf");
+    QCoreApplication::setApplicationVersion(QString(CYANPDF_VERSION));
+    QCoreApplication::setOrganizationDomain(QString(CYANPDF_ID));
+
+    CyanPDFTrace::start(CyanPDFTrace::getFilename(argc, argv));
+
+    if (CyanPDFBatch::isBatch(argc, argv)) {
+        QCoreApplication a(argc, argv);
+        CyanPDFBatch batch;
+        const int result = batch.exec(a.arguments());
+        CyanPDFTrace::stop();
+        return result;
+    }
+
     QApplication a(argc, argv);
-    QApplication::setApplicationName("cyanpdf");
-    QApplication::setOrganizationName("cyanpdf");
-    QApplication::setApplicationVersion(QString(CYANPDF_VERSION));
-    QApplication::setOrganizationDomain(QString(CYANPDF_ID));
     QGuiApplication::setDesktopFileName(QString(CYANPDF_ID));
 
     CyanPDF w;
     w.show();
-    return a.exec();
+    const int result = a.exec();
+    CyanPDFTrace::stop();
+    return result;
 }